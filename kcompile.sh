@@ -1,2 +1,10 @@
  ##gcc -lm main.c xypicmic.c xypicmic.h -o xypicmic.exe
- gcc -lm main.c xypicmic.c -o xypicmic.exe -std=c99
+ gcc main.c xylut.c xypicmic.c xyformat.c xybatch.c xytext.c xyindex.c xycache.c xymask.c xyaccum.c xyraster.c xyincr.c xyparallel.c xyserver.c xydispatch.c xyarchive.c xymonitor.c xyresolve.c xyunion.c -o xypicmic.exe -std=c99 -pthread -lm
+ gcc xyvalidate.c xyreference.c xypicmic.c xyformat.c xybatch.c xytext.c xyindex.c xycache.c xymask.c xyaccum.c xyraster.c xyparallel.c xydispatch.c xyarchive.c xysynth.c xymonitor.c xyresolve.c xyunion.c xyincr.c xylut.c -o xyvalidate.exe -std=c99 -pthread -lm
+ gcc xyvalidate.c xyreference.c xypicmic.c xyformat.c xybatch.c xytext.c xyindex.c xycache.c xymask.c xyaccum.c xyraster.c xyparallel.c xydispatch.c xyarchive.c xysynth.c xymonitor.c xyresolve.c xyunion.c xyincr.c xylut.c -o xyvalidate_asan.exe -g -fsanitize=address -std=c99 -pthread -lm
+ gcc xypack.c xyarchive.c xypicmic.c xyformat.c xybatch.c xytext.c xyindex.c xycache.c xymask.c xyaccum.c xyraster.c xyparallel.c xydispatch.c xymonitor.c xyresolve.c xyunion.c -o xypack.exe -std=c99 -pthread -lm
+ gcc xyload.c xysynth.c xypicmic.c xyformat.c xybatch.c xytext.c xyindex.c xycache.c xymask.c xyaccum.c xyraster.c xyparallel.c xydispatch.c xyarchive.c xymonitor.c xyresolve.c xyunion.c -o xyload.exe -std=c99 -pthread -lm
+ gcc xysim.c xysynth.c xyresolve.c xyunion.c xypicmic.c xyformat.c xyarchive.c -o xysim.exe -std=c99 -pthread -lm
+ gcc xymon.c xymonitor.c xyformat.c -o xymon.exe -std=c99 -pthread -lm
+ gcc xysweep.c xybatch.c xytext.c xyindex.c xyunion.c xypicmic.c xyformat.c xyarchive.c xycache.c xymask.c xyaccum.c xyraster.c xyparallel.c xydispatch.c xymonitor.c xyresolve.c -o xysweep.exe -std=c99 -pthread -lm
+ gcc xyquery.c xyindex.c xybatch.c xytext.c xyunion.c xypicmic.c xyformat.c xyarchive.c xycache.c xymask.c xyaccum.c xyraster.c xyparallel.c xydispatch.c xymonitor.c xyresolve.c -o xyquery.exe -std=c99 -pthread -lm
@@ -7,11 +7,137 @@
 #include <unistd.h>
 #include <limits.h>
 #include "xypicmic.h"
+#include "xybatch.h"
+#include "xyserver.h"
+#include "xymask.h"
+#include "xyformat.h"
+#include "xyprobe.h"
+#include "xylut.h"
+
+static void usage(const char *prog) {
+    printf("Usage: %s <number of elements> <list of row and column pairs>\n", prog);
+    printf("       %s -b <event file|-> [-c <cache MB>] [-m <mask file>] [-H <max rate>] [-w <window events>]\n", prog);
+    printf("           [-t <threads>] [-a <histogram file>] [-r <display dir> [-R ppm|png] [-W <width>]]\n");
+    printf("           [-i <hits> -j <threads per event> | -T <tuning file|->] [-M <membership file>] [-P <monitor name>]\n");
+    printf("           [-A <strip tolerance> | -U [-j <threads per event>]] [-L <max intersections per event>] [-X <index file>]\n");
+    printf("           [-I <intersection table cache|->]\n");
+    printf("       %s -S <socket path> [-t <workers>] [-c <cache MB>] [-m <mask file>] [-i <hits> -j <threads per event> | -T <tuning file|->]\n", prog);
+    printf("           [-P <monitor name>] [-A <strip tolerance> | -U [-j <threads per event>]] [-L <max intersections per event>]\n");
+    printf("           [-I <intersection table cache|->]\n");
+}
+
+// "%c%d;(%.02f, %0.2f); (%0.2f, %0.2f)\n"
+static void putLine(TextBuffer *tb, const LineCoordinates *line) {
+    putChar(tb, line->type);
+    putInt(tb, (int)line->val);
+    putText(tb, ";(");
+    putFixed(tb, line->x_start, 2);
+    putText(tb, ", ");
+    putFixed(tb, line->y_start, 2);
+    putText(tb, "); (");
+    putFixed(tb, line->x_end, 2);
+    putText(tb, ", ");
+    putFixed(tb, line->y_end, 2);
+    putText(tb, ")\n");
+}
+
+// "%d;%d;%d;%.04f;%0.4f\n"
+static void putCentroid(TextBuffer *tb, const IntersectionPoint *centroid) {
+    putInt(tb, centroid->num);
+    putChar(tb, ';');
+    putInt(tb, (int)centroid->flag);
+    putChar(tb, ';');
+    putInt(tb, centroid->intersects);
+    putChar(tb, ';');
+    putFixed(tb, centroid->x, 4);
+    putChar(tb, ';');
+    putFixed(tb, centroid->y, 4);
+    putChar(tb, '\n');
+}
+
+// Batch mode: events read one per line, centroids written to stdout
+static int batchMain(int argc, char *argv[]) {
+    const char *input = NULL;
+    const char *socketPath = NULL;
+    const char *tableFile = NULL;
+    BatchOptions opt = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            opt.cacheBytes = (size_t)(atof(argv[++i]) * 1024 * 1024);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            opt.maskFile = argv[++i];
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            opt.maxRate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            opt.maskWindow = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            opt.accumulateFile = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            opt.renderDir = argv[++i];
+        } else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            opt.renderPPM = strcmp(argv[++i], "ppm") == 0;
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            opt.renderWidth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            opt.parallelMinHits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            opt.parallelThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            opt.tuningFile = argv[++i];
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            opt.membersFile = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            opt.monitorName = argv[++i];
+        } else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            opt.resolveTolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-U") == 0) {
+            opt.unionClustering = 1;
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            opt.workBudget = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-X") == 0 && i + 1 < argc) {
+            opt.indexFile = argv[++i];
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+            tableFile = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    // crossings from the precomputed tables, kept for the whole run
+    if (tableFile != NULL && (intersectionLUT = loadIntersectionLUT(tableFile)) == NULL) return 1;
+    if (socketPath != NULL) return runServer(socketPath, &opt);
+    if (input == NULL) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *in = strcmp(input, "-") == 0 ? stdin : fopen(input, "rb");
+    if (in == NULL) {
+        perror("Error opening event file");
+        return 1;
+    }
+    int status = runBatch(in, stdout, &opt);
+    if (in != stdin) fclose(in);
+    return status;
+}
 
 int main(int argc, char *argv[]) {
+    if (argc > 1 && argv[1][0] == '-') return batchMain(argc, argv);
+
+    // hot pixels removed in earlier runs
+    const char *maskFile = getenv("XYPICMIC_MASK");
+    if (maskFile != NULL && loadPixelMask(maskFile) != 0) return 1;
+
     //Sanity Checks
     if (argc < 3) {
-        printf("Usage: %s <number of elements> <list of row and column pairs>\n", argv[0]);
+        usage(argv[0]);
         return 1;
     }
 
@@ -30,7 +156,9 @@ int main(int argc, char *argv[]) {
     LineCoordinates *lineInEvent = (LineCoordinates *)malloc(numElements * sizeof(LineCoordinates));
     
     int y_size=0; int r_size=0; int b_size=0; 
+    XY_PROBE2(fill_lines_entry, 0, numElements);
     fillLines(argv, lineInEvent, numElements, &y_size, &r_size, &b_size);
+    XY_PROBE4(fill_lines_exit, 0, y_size, r_size, b_size);
 
     // -----------------------------------------------------------------
     // Arrays of struct allocation (according ot its' color)
@@ -72,13 +200,20 @@ int main(int argc, char *argv[]) {
     */
     
 
+    // text written through large buffers, see xyformat.h; `text` is flushed before any printf
+    TextBuffer text, csvText;
+    initTextBuffer(&text, stdout, TEXT_BUFFER_SIZE);
+
     printf("------------------------->>>>  Lines in Event:  <<<<<<<<<<<<<<<<<-----------------\n");
     printf("track;pt0;pt1\n");
-    fprintf(csvFile, "track;pt0;pt1\n"); 
+    initTextBuffer(&csvText, csvFile, TEXT_BUFFER_SIZE);
+    putText(&csvText, "track;pt0;pt1\n"); 
     for (int idx=0 ; idx< numElements;  idx++){
-        fprintf(csvFile,"%c%d;(%.02f, %0.2f); (%0.2f, %0.2f)\n",lineInEvent[idx].type,lineInEvent[idx].val , lineInEvent[idx].x_start, lineInEvent[idx].y_start, lineInEvent[idx].x_end, lineInEvent[idx].y_end);
-        printf("%c%d;(%.02f, %0.2f); (%0.2f, %0.2f)\n",lineInEvent[idx].type,lineInEvent[idx].val , lineInEvent[idx].x_start, lineInEvent[idx].y_start, lineInEvent[idx].x_end, lineInEvent[idx].y_end);
+        putLine(&csvText, &lineInEvent[idx]);
+        putLine(&text, &lineInEvent[idx]);
     }
+    freeTextBuffer(&csvText);
+    flushTextBuffer(&text);
     fclose(csvFile);
 
     // -----------------------------------------------------------------
@@ -89,47 +224,77 @@ int main(int argc, char *argv[]) {
     IntersectionPoint *intersections;
     if (combinations>0){
         intersections = (IntersectionPoint *)malloc(combinations * sizeof(IntersectionPoint));
+        XY_PROBE4(xlines_entry, 0, y_size, r_size, b_size);
         xLines(intersections,combinations,ylines,y_size,rlines,r_size,blines,b_size,&interCount);
+        XY_PROBE2(xlines_exit, 0, interCount);
     }
     else {
+    	freeTextBuffer(&text);
     	printf("NOT COMBINATIONS \n");
 	return 1;
     }
 
     printf("------------------------->>>>  Intersections:  <<<<<<<<<<<<<<<<<-----------------\n");
     printf("intercoutn=%d\n",interCount);
-    fprintf(csvFile1, "x;y\n"); 
+    initTextBuffer(&csvText, csvFile1, TEXT_BUFFER_SIZE);
+    putText(&csvText, "x;y\n"); 
     for (int idx=0 ; idx< interCount;  idx++){
-        printf("indx=%d, intersects:%d -- ,x0=%.02f, y0=%0.2f\n", idx,intersections[idx].intersects, intersections[idx].x, intersections[idx].y);
-        fprintf(csvFile1,"%.04f;%0.4f\n", intersections[idx].x, intersections[idx].y); 
+        // "indx=%d, intersects:%d -- ,x0=%.02f, y0=%0.2f\n"
+        putText(&text, "indx=");
+        putInt(&text, idx);
+        putText(&text, ", intersects:");
+        putInt(&text, intersections[idx].intersects);
+        putText(&text, " -- ,x0=");
+        putFixed(&text, intersections[idx].x, 2);
+        putText(&text, ", y0=");
+        putFixed(&text, intersections[idx].y, 2);
+        putChar(&text, '\n');
+        // "%.04f;%0.4f\n"
+        putFixed(&csvText, intersections[idx].x, 4);
+        putChar(&csvText, ';');
+        putFixed(&csvText, intersections[idx].y, 4);
+        putChar(&csvText, '\n');
     }
+    freeTextBuffer(&csvText);
+    flushTextBuffer(&text);
     fclose(csvFile1);
 
     printf("------------------------->>>>  Centroids :  <<<<<<<<<<<<<<<<<-----------------\n");
     
-    fprintf(csvFile2, "numCluster;centroidFlag; centroid3Colors;x;y\n"); 
+    initTextBuffer(&csvText, csvFile2, TEXT_BUFFER_SIZE);
+    putText(&csvText, "numCluster;centroidFlag; centroid3Colors;x;y\n"); 
     if (interCount>0){
     	IntersectionPoint *centroids;//[interCount];
     	centroids = (IntersectionPoint *)malloc(interCount * sizeof(IntersectionPoint));
     	init_array(centroids,interCount);    
+    	XY_PROBE3(fill_centroids_entry, 0, interCount, threshold);
+    	int nClusters = 1;
     	if (interCount==1) 
 	        centroids[0] = intersections[0];
     	else  
-    	    fillCentroids(threshold, intersections,interCount, centroids, interCount );
+    	    nClusters = fillCentroids(threshold, intersections,interCount, centroids, interCount );
+    	XY_PROBE3(fill_centroids_exit, 0, interCount, nClusters);
    //}
 
     	printf("numCluster;centroidFlag; centroid3Colors;x;y\n"); 
     	//fprintf(csvFile2, "numCluster;centroidFlag; centroid3Colors;x;y\n"); 
         //fprintf(csvFile3,"numCluster;x;y\n");
+    	XY_PROBE2(output_entry, 0, nClusters);
+    	int rows = 0;
     	for (int idx=0 ; idx< interCount;  idx++){
         	if ( centroids[idx].num>-1 && centroids[idx].flag == 7 ){
         	//if ( centroids[idx].num>-1  ){
-        		printf("%d;%d;%d;%.04f;%0.4f\n",centroids[idx].num,centroids[idx].flag, centroids[idx].intersects, centroids[idx].x, centroids[idx].y);
-        		fprintf(csvFile2,"%d;%d;%d;%.04f;%0.4f\n",centroids[idx].num,centroids[idx].flag, centroids[idx].intersects, centroids[idx].x, centroids[idx].y);
+        		putCentroid(&text, &centroids[idx]);
+        		putCentroid(&csvText, &centroids[idx]);
+        		rows++;
 	 	}
 	 }
+    	XY_PROBE2(output_exit, 0, rows);
+    	(void)nClusters;                    // only read by the tracepoints
     	free(centroids);
     }
+    freeTextBuffer(&csvText);
+    freeTextBuffer(&text);
     fclose(csvFile2);
     //fclose(csvFile3);
 
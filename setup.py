@@ -0,0 +1,16 @@
+# Python module of the reconstruction core: python setup.py build_ext --inplace
+from setuptools import setup, Extension
+import numpy
+
+setup(
+    name="xypicmic",
+    ext_modules=[
+        Extension(
+            "xypicmic",
+            sources=["xypicmicmodule.c", "xypicmic.c", "xyformat.c"],
+            include_dirs=[numpy.get_include()],
+            extra_compile_args=["-std=c99"],
+            libraries=["m"],
+        )
+    ],
+)
@@ -0,0 +1,33 @@
+# Tests of the Python module: python setup.py build_ext --inplace && python -m unittest test_xypicmicmodule
+import unittest
+
+import numpy as np
+import xypicmic
+
+HITS = np.array([[33, 25], [7, 30], [97, 12], [50, 6], [103, 35], [34, 37]])
+
+
+class ReconstructBatchTest(unittest.TestCase):
+    def test_events_match_single_calls(self):
+        lines, intersections, centroids, offsets = xypicmic.reconstruct_batch(HITS, [3, 3])
+        for i, (first, last) in enumerate([(0, 3), (3, 6)]):
+            _, _, single = xypicmic.reconstruct(HITS[first:last])
+            event = centroids[offsets[i][2]:offsets[i + 1][2]]
+            np.testing.assert_array_equal(event, single)
+
+    def test_negative_count_is_rejected(self):
+        # sums to the number of hits, but would move backwards through the hits
+        with self.assertRaises(ValueError):
+            xypicmic.reconstruct_batch(HITS, [6, -1, 1])
+        with self.assertRaises(ValueError):
+            xypicmic.reconstruct_batch(HITS, [-1, 7])
+
+    def test_counts_must_cover_the_hits(self):
+        with self.assertRaises(ValueError):
+            xypicmic.reconstruct_batch(HITS, [2, 3])
+        with self.assertRaises(ValueError):
+            xypicmic.reconstruct_batch(HITS, [4, 3])
+
+
+if __name__ == "__main__":
+    unittest.main()
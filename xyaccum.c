@@ -0,0 +1,97 @@
+#include "xyaccum.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+Accumulator *createAccumulator(void){
+    return (Accumulator *)calloc(1, sizeof(Accumulator));
+}
+
+static void fill1D(unsigned int *hist, int nBins, int value){
+    hist[value < nBins-1 ? value : nBins-1]++;
+}
+
+// Strips are taken from the hits with the selection of fillLinesFromHits(), so that the
+// event can come from the result cache without its intersections.
+void accumulateEvent(Accumulator *acc, const PixelHit *hits, int nHits, const IntersectionPoint *centroids, int nCentroids,
+                     int interCount){
+    for (int i = 0; i < nHits; i++){
+        int row = hits[i].row, col = hits[i].col;
+        if (row < 0 || row >= ROWS || col < 0 || col >= COLS || PIXEL_MASKED(row, col)) continue;
+        int color = assign_number(arr[row][col][0]);
+        if (color < 0) continue;
+        int value = atoi(&arr[row][col][1]);
+        acc->stripOccupancy[color][value]++;
+    }
+    acc->events++;
+    fill1D(acc->hitMultiplicity, ACC_MULT_BINS, nHits);
+    if (interCount < 0){
+        acc->skipped++;
+        return;
+    }
+
+    int threeColors = 0;
+    for (int i = 0; i < nCentroids; i++){
+        if (centroids[i].num < 0 || centroids[i].flag != 7) continue;
+        threeColors++;
+        int ix = (int)((centroids[i].x - ACC_XMIN) / ACC_BIN);
+        int iy = (int)((centroids[i].y - ACC_YMIN) / ACC_BIN);
+        if (centroids[i].x >= ACC_XMIN && centroids[i].y >= ACC_YMIN && ix < ACC_NX && iy < ACC_NY)
+            acc->centroidMap[iy][ix]++;
+        else
+            acc->outside++;
+    }
+    fill1D(acc->clusterMultiplicity, ACC_MULT_BINS, nCentroids);
+    fill1D(acc->threeColorMultiplicity, ACC_MULT_BINS, threeColors);
+    fill1D(acc->interCount, ACC_INTER_BINS, interCount);
+}
+
+static void add(unsigned int *into, const unsigned int *from, int n){
+    for (int i = 0; i < n; i++) into[i] += from[i];
+}
+
+void mergeAccumulator(Accumulator *into, const Accumulator *from){
+    into->events += from->events;
+    into->outside += from->outside;
+    into->skipped += from->skipped;
+    add(&into->centroidMap[0][0], &from->centroidMap[0][0], ACC_NY*ACC_NX);
+    add(&into->stripOccupancy[0][0], &from->stripOccupancy[0][0], 3*STRIP_SLOTS);
+    add(into->hitMultiplicity, from->hitMultiplicity, ACC_MULT_BINS);
+    add(into->clusterMultiplicity, from->clusterMultiplicity, ACC_MULT_BINS);
+    add(into->threeColorMultiplicity, from->threeColorMultiplicity, ACC_MULT_BINS);
+    add(into->interCount, from->interCount, ACC_INTER_BINS);
+}
+
+// Only the filled bins are written, as "histogram;bin;count" (bin is "ix,iy" for the map
+// and the strip name for the occupancy). The last bin of a multiplicity is the overflow.
+static void write1D(FILE *f, const char *name, const unsigned int *hist, int nBins){
+    for (int i = 0; i < nBins; i++){
+        if (hist[i]) fprintf(f, "%s;%d;%u\n", name, i, hist[i]);
+    }
+}
+
+int writeAccumulator(const Accumulator *acc, const char *path){
+    static const char colors[3] = {'Y', 'R', 'B'};
+    FILE *f = fopen(path, "w");
+    if (f == NULL){
+        perror("Error opening accumulate file");
+        return -1;
+    }
+    fprintf(f, "# events=%lu centroidMap=%dx%d xmin=%.0f ymin=%.0f bin=%.0f outside=%lu skipped=%lu\n",
+            acc->events, ACC_NX, ACC_NY, ACC_XMIN, ACC_YMIN, ACC_BIN, acc->outside, acc->skipped);
+    fprintf(f, "histogram;bin;count\n");
+    for (int iy = 0; iy < ACC_NY; iy++){
+        for (int ix = 0; ix < ACC_NX; ix++){
+            if (acc->centroidMap[iy][ix]) fprintf(f, "centroidMap;%d,%d;%u\n", ix, iy, acc->centroidMap[iy][ix]);
+        }
+    }
+    for (int c = 0; c < 3; c++){
+        for (int v = 0; v < STRIP_SLOTS; v++){
+            if (acc->stripOccupancy[c][v]) fprintf(f, "stripOccupancy;%c%d;%u\n", colors[c], v, acc->stripOccupancy[c][v]);
+        }
+    }
+    write1D(f, "hitMultiplicity", acc->hitMultiplicity, ACC_MULT_BINS);
+    write1D(f, "clusterMultiplicity", acc->clusterMultiplicity, ACC_MULT_BINS);
+    write1D(f, "threeColorMultiplicity", acc->threeColorMultiplicity, ACC_MULT_BINS);
+    write1D(f, "interCount", acc->interCount, ACC_INTER_BINS);
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,37 @@
+#ifndef XYACCUM_H
+#define XYACCUM_H
+
+#include "xypicmic.h"
+
+// Monitoring aggregates filled in memory over any number of events. Each worker fills
+// its own Accumulator, the copies are merged once at the end of the run.
+
+#define ACC_XMIN -4000.0                // same window as plotter.py, in um
+#define ACC_YMIN -4000.0
+#define ACC_BIN 50.0
+#define ACC_NX 180
+#define ACC_NY 160
+#define ACC_MULT_BINS 256               // last bin is the overflow
+#define ACC_INTER_BINS 4096
+
+typedef struct {
+    unsigned long events;
+    unsigned long outside;              // 3-color centroids out of the map
+    unsigned long skipped;              // events not reconstructed, only in the hit histograms
+    unsigned int centroidMap[ACC_NY][ACC_NX];
+    unsigned int stripOccupancy[3][STRIP_SLOTS];
+    unsigned int hitMultiplicity[ACC_MULT_BINS];
+    unsigned int clusterMultiplicity[ACC_MULT_BINS];
+    unsigned int threeColorMultiplicity[ACC_MULT_BINS];
+    unsigned int interCount[ACC_INTER_BINS];
+} Accumulator;
+
+Accumulator *createAccumulator(void);
+// interCount is the one of the reconstruction (EventResult.interCount, or the cached one); -1 for
+// an event that was not reconstructed (over the work budget), whose centroids are then ignored
+void accumulateEvent(Accumulator *acc, const PixelHit *hits, int nHits, const IntersectionPoint *centroids, int nCentroids,
+                     int interCount);
+void mergeAccumulator(Accumulator *into, const Accumulator *from);
+int writeAccumulator(const Accumulator *acc, const char *path);
+
+#endif /* XYACCUM_H */
@@ -0,0 +1,325 @@
+#include "xyarchive.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ArchiveWriter {
+    FILE *out;
+    int blockEvents;
+    int keepOrder;
+    int64_t nextEvent;
+    ArchiveBlockHeader header;          // of the block being filled
+    unsigned char *payload;
+    size_t payloadSize;
+    size_t payloadCap;
+    uint64_t *keys;                     // index << 32 | readout position, per valid hit
+    int *ranks;
+    int sortCap;
+    int failed;
+};
+
+struct ArchiveReader {
+    FILE *in;
+    ArchiveBlockHeader header;
+    unsigned char *payload;
+    size_t payloadCap;
+    PixelHit *hits;                     // the decoded block
+    int hitCap;
+    int *counts;
+    int countCap;
+    int next;                           // next event of the block
+    int offset;                         // its first hit
+    int64_t blockOffset;                // file offset of the block header
+    int64_t nextBlock;
+};
+
+// ----------------------------------------------------------------
+// writer
+// ----------------------------------------------------------------
+
+static int reservePayload(ArchiveWriter *w, size_t n){
+    if (w->payloadSize + n <= w->payloadCap) return 0;
+    size_t cap = 2*(w->payloadSize + n);
+    unsigned char *p = (unsigned char *)realloc(w->payload, cap);
+    if (p == NULL) return -1;
+    w->payload = p;
+    w->payloadCap = cap;
+    return 0;
+}
+
+static void putVarint(ArchiveWriter *w, uint32_t v){
+    while (v >= 0x80){
+        w->payload[w->payloadSize++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    w->payload[w->payloadSize++] = (unsigned char)v;
+}
+
+static int flushBlock(ArchiveWriter *w){
+    if (w->header.nEvents == 0) return 0;
+    w->header.payloadBytes = (uint32_t)w->payloadSize;
+    if (fwrite(&w->header, sizeof(w->header), 1, w->out) != 1 ||
+        fwrite(w->payload, 1, w->payloadSize, w->out) != w->payloadSize) return -1;
+    w->nextEvent = w->header.firstEvent + w->header.nEvents;
+    memset(&w->header, 0, sizeof(w->header));
+    w->header.firstEvent = w->nextEvent;
+    w->payloadSize = 0;
+    return 0;
+}
+
+ArchiveWriter *createArchiveWriter(FILE *out, int blockEvents, int keepOrder){
+    ArchiveWriter *w = (ArchiveWriter *)calloc(1, sizeof(ArchiveWriter));
+    if (w == NULL) return NULL;
+    w->out = out;
+    w->blockEvents = blockEvents > 0 ? blockEvents : ARCHIVE_BLOCK_EVENTS;
+    w->keepOrder = keepOrder;
+    uint32_t version = ARCHIVE_VERSION;
+    if (fwrite(ARCHIVE_MAGIC, 1, 4, out) != 4 || fwrite(&version, sizeof(version), 1, out) != 1){
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+static int compareKeys(const void *a, const void *b){
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int writeArchiveEvent(ArchiveWriter *w, const PixelHit *hits, int nHits){
+    if (nHits > w->sortCap){
+        uint64_t *keys = (uint64_t *)realloc(w->keys, nHits * sizeof(uint64_t));
+        if (keys == NULL) return -1;
+        w->keys = keys;
+        int *ranks = (int *)realloc(w->ranks, nHits * sizeof(int));
+        if (ranks == NULL) return -1;
+        w->ranks = ranks;
+        w->sortCap = nHits;
+    }
+    uint64_t *keys = w->keys;
+    int nValid = 0;
+    for (int i = 0; i < nHits; i++){
+        if (hits[i].row < 0 || hits[i].row >= ROWS || hits[i].col < 0 || hits[i].col >= COLS) continue;
+        keys[nValid] = (uint64_t)(hits[i].row*COLS + hits[i].col) << 32 | (uint32_t)nValid;
+        nValid++;
+    }
+    int nOut = nHits - nValid;
+    int ordered = 0;
+    for (int i = 1; i < nValid; i++){
+        if (keys[i] >> 32 < keys[i-1] >> 32) ordered = w->keepOrder;
+    }
+    if (ordered || !w->keepOrder) qsort(keys, nValid, sizeof(uint64_t), compareKeys);
+
+    // worst case 5 bytes per varint
+    if (reservePayload(w, 5 * (2 + 2*(size_t)nValid)) != 0) return -1;
+    putVarint(w, (uint32_t)nValid << 2 | (nOut > 0) << 1 | ordered);
+    if (nOut > 0) putVarint(w, (uint32_t)nOut);
+    uint32_t previous = 0;
+    for (int k = 0; k < nValid; k++){
+        uint32_t index = (uint32_t)(keys[k] >> 32);
+        putVarint(w, index - previous);
+        previous = index;
+        w->ranks[(uint32_t)keys[k]] = k;
+    }
+    if (ordered){
+        for (int i = 0; i < nValid; i++) putVarint(w, (uint32_t)w->ranks[i]);
+    }
+    w->header.nEvents++;
+    w->header.nHits += (uint32_t)nHits;
+    if ((int)w->header.nEvents == w->blockEvents) return flushBlock(w);
+    return 0;
+}
+
+int closeArchiveWriter(ArchiveWriter *w){
+    int status = flushBlock(w);
+    free(w->payload);
+    free(w->keys);
+    free(w->ranks);
+    free(w);
+    return status;
+}
+
+// ----------------------------------------------------------------
+// reader
+// ----------------------------------------------------------------
+
+static int getVarint(const unsigned char **p, const unsigned char *end, uint32_t *v){
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7){
+        if (*p == end) return -1;
+        unsigned char c = *(*p)++;
+        value |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)){
+            *v = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Decodes the nEvents events of a payload: hit counts in counts[], hits back to back in hits[].
+// Returns the number of hits, -1 if the payload is corrupt or holds more than maxHits hits.
+int decodeArchiveBlock(const unsigned char *payload, size_t size, int nEvents, PixelHit *hits, int maxHits, int *counts){
+    const unsigned char *p = payload, *end = payload + size;
+    int total = 0;
+    for (int e = 0; e < nEvents; e++){
+        uint32_t head, nOut = 0;
+        if (getVarint(&p, end, &head) != 0) return -1;
+        uint32_t nValid = head >> 2;
+        if ((head & 2) && getVarint(&p, end, &nOut) != 0) return -1;
+        if ((uint64_t)total + nValid + nOut > (uint64_t)maxHits) return -1;
+        PixelHit *out = hits + total;
+        uint32_t index = 0;
+        if (head & 1){
+            // sorted pixels parked after the event, then gathered in readout order
+            PixelHit *sorted = out + nValid;
+            if ((uint64_t)total + 2*(uint64_t)nValid > (uint64_t)maxHits) return -1;
+            for (uint32_t k = 0; k < nValid; k++){
+                uint32_t delta;
+                if (getVarint(&p, end, &delta) != 0 || (index += delta) >= NUM_PIXELS) return -1;
+                sorted[k].row = (int)(index / COLS);
+                sorted[k].col = (int)(index % COLS);
+            }
+            for (uint32_t i = 0; i < nValid; i++){
+                uint32_t rank;
+                if (getVarint(&p, end, &rank) != 0 || rank >= nValid) return -1;
+                out[i] = sorted[rank];
+            }
+        } else {
+            for (uint32_t k = 0; k < nValid; k++){
+                uint32_t delta;
+                if (getVarint(&p, end, &delta) != 0 || (index += delta) >= NUM_PIXELS) return -1;
+                out[k].row = (int)(index / COLS);
+                out[k].col = (int)(index % COLS);
+            }
+        }
+        for (uint32_t k = 0; k < nOut; k++){
+            out[nValid + k].row = -1;
+            out[nValid + k].col = -1;
+        }
+        counts[e] = (int)(nValid + nOut);
+        total += counts[e];
+    }
+    return p == end ? total : -1;
+}
+
+int isArchive(FILE *in){
+    int c = getc(in);
+    if (c == EOF) return 0;
+    ungetc(c, in);
+    return c == (unsigned char)ARCHIVE_MAGIC[0];
+}
+
+ArchiveReader *openArchiveReader(FILE *in){
+    char magic[4];
+    uint32_t version;
+    if (fread(magic, 1, 4, in) != 4 || memcmp(magic, ARCHIVE_MAGIC, 4) != 0 ||
+        fread(&version, sizeof(version), 1, in) != 1 || version != ARCHIVE_VERSION){
+        fprintf(stderr, "Not an event archive (version %d)\n", ARCHIVE_VERSION);
+        return NULL;
+    }
+    ArchiveReader *r = (ArchiveReader *)calloc(1, sizeof(ArchiveReader));
+    if (r == NULL) return NULL;
+    r->in = in;
+    r->nextBlock = ftell(in) > 0 ? ftell(in) : 4 + (int64_t)sizeof(version);
+    return r;
+}
+
+// Next block header and payload. Returns 1, 0 at end of file, -1 on a truncated block.
+int readArchiveBlock(FILE *in, ArchiveBlockHeader *header, unsigned char **payload, size_t *payloadCap){
+    size_t got = fread(header, 1, sizeof(*header), in);
+    if (got == 0) return 0;
+    if (got != sizeof(*header)) return -1;
+    if (header->payloadBytes > *payloadCap){
+        unsigned char *p = (unsigned char *)realloc(*payload, header->payloadBytes);
+        if (p == NULL) return -1;
+        *payload = p;
+        *payloadCap = header->payloadBytes;
+    }
+    return fread(*payload, 1, header->payloadBytes, in) == header->payloadBytes ? 1 : -1;
+}
+
+// Reads and decodes the next block, same return values as readArchiveBlock()
+static int loadBlock(ArchiveReader *r){
+    int rc = readArchiveBlock(r->in, &r->header, &r->payload, &r->payloadCap);
+    if (rc <= 0){
+        if (rc < 0) fprintf(stderr, "Truncated archive block\n");
+        r->header.nEvents = 0;
+        r->next = 0;
+        return rc;
+    }
+    r->blockOffset = r->nextBlock;
+    r->nextBlock += (int64_t)sizeof(ArchiveBlockHeader) + r->header.payloadBytes;
+    // room for the ordered events, decoded through a parking area of nValid hits
+    int need = 2*(int)r->header.nHits + 1;
+    if (need > r->hitCap){
+        PixelHit *h = (PixelHit *)realloc(r->hits, need * sizeof(PixelHit));
+        if (h == NULL) return -1;
+        r->hits = h;
+        r->hitCap = need;
+    }
+    if ((int)r->header.nEvents > r->countCap){
+        int *c = (int *)realloc(r->counts, r->header.nEvents * sizeof(int));
+        if (c == NULL) return -1;
+        r->counts = c;
+        r->countCap = (int)r->header.nEvents;
+    }
+    int total = decodeArchiveBlock(r->payload, r->header.payloadBytes, (int)r->header.nEvents, r->hits, r->hitCap, r->counts);
+    if (total != (int)r->header.nHits){
+        fprintf(stderr, "Corrupt archive block at event %lld\n", (long long)r->header.firstEvent);
+        r->header.nEvents = 0;
+        r->next = 0;
+        return -1;
+    }
+    r->next = 0;
+    r->offset = 0;
+    return 1;
+}
+
+// Same contract as readEvent(): 1 event read, 0 end of input, -1 error
+int readArchiveEvent(ArchiveReader *r, PixelHit **hits, int *hitCap, int *nHits){
+    while (r->next == (int)r->header.nEvents){
+        int rc = loadBlock(r);
+        if (rc <= 0) return rc;
+    }
+    int n = r->counts[r->next];
+    if (n > *hitCap){
+        PixelHit *h = (PixelHit *)realloc(*hits, n * sizeof(PixelHit));
+        if (h == NULL) return -1;
+        *hits = h;
+        *hitCap = n;
+    }
+    memcpy(*hits, r->hits + r->offset, n * sizeof(PixelHit));
+    *nHits = n;
+    r->offset += n;
+    r->next++;
+    return 1;
+}
+
+int64_t archiveEventOffset(const ArchiveReader *r, int *inBlock){
+    *inBlock = r->next - 1;
+    return r->blockOffset;
+}
+
+int seekArchiveEvent(ArchiveReader *r, int64_t blockOffset, int inBlock){
+    if (r->header.nEvents > 0 && blockOffset == r->blockOffset && inBlock >= 0 && inBlock < (int)r->header.nEvents){
+        for (r->next = 0, r->offset = 0; r->next < inBlock; r->next++) r->offset += r->counts[r->next];
+        return 0;                       // still decoded
+    }
+    if (fseek(r->in, (long)blockOffset, SEEK_SET) != 0){
+        perror("Event archive");
+        return -1;
+    }
+    clearerr(r->in);
+    r->nextBlock = blockOffset;
+    if (loadBlock(r) <= 0 || inBlock < 0 || inBlock >= (int)r->header.nEvents) return -1;
+    for (r->next = 0; r->next < inBlock; r->next++) r->offset += r->counts[r->next];
+    return 0;
+}
+
+void closeArchiveReader(ArchiveReader *r){
+    if (r == NULL) return;
+    free(r->payload);
+    free(r->hits);
+    free(r->counts);
+    free(r);
+}
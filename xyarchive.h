@@ -0,0 +1,51 @@
+#ifndef XYARCHIVE_H
+#define XYARCHIVE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "xypicmic.h"
+
+// Compressed event archive. File: ARCHIVE_MAGIC, uint32 version, then blocks of events, each
+// an ArchiveBlockHeader followed by its payload, so that blocks can be located by skipping
+// payloads and decoded independently (decodeArchiveBlock() is thread safe).
+// Event in a payload, all numbers LEB128 varints:
+//   nValid << 2 | hasOutOfRange << 1 | ordered
+//   [nOutOfRange]                      if hasOutOfRange: hits outside the matrix, only counted
+//   nValid pixel indices (row*COLS + col), sorted, as deltas from the previous one
+//   [nValid ranks]                     if ordered: readout position i holds sorted hit rank[i]
+// The readout order is kept (ordered) unless the writer drops it or it is already sorted, so an
+// archive reconstructs exactly like the text file it came from (the clustering depends on the
+// hit order). Out-of-range hits come back at the end of the event as row = col = -1.
+
+#define ARCHIVE_MAGIC "\x89XYA"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_BLOCK_EVENTS 4096
+
+typedef struct {
+    uint32_t payloadBytes;
+    uint32_t nEvents;
+    uint32_t nHits;                     // hits of all the events once decoded
+    uint32_t reserved;
+    int64_t firstEvent;
+} ArchiveBlockHeader;
+
+typedef struct ArchiveWriter ArchiveWriter;
+typedef struct ArchiveReader ArchiveReader;
+
+ArchiveWriter *createArchiveWriter(FILE *out, int blockEvents, int keepOrder);
+int writeArchiveEvent(ArchiveWriter *writer, const PixelHit *hits, int nHits);
+int closeArchiveWriter(ArchiveWriter *writer);      // writes the last block and frees
+
+int isArchive(FILE *in);                            // peeks at the first byte only
+ArchiveReader *openArchiveReader(FILE *in);
+int readArchiveBlock(FILE *in, ArchiveBlockHeader *header, unsigned char **payload, size_t *payloadCap);
+int readArchiveEvent(ArchiveReader *reader, PixelHit **hits, int *hitCap, int *nHits);
+void closeArchiveReader(ArchiveReader *reader);
+// Where the last event read is: file offset of its block header and position in the block.
+// seekArchiveEvent() goes back there, the next readArchiveEvent() returning that event.
+int64_t archiveEventOffset(const ArchiveReader *reader, int *inBlock);
+int seekArchiveEvent(ArchiveReader *reader, int64_t blockOffset, int inBlock);
+
+int decodeArchiveBlock(const unsigned char *payload, size_t size, int nEvents, PixelHit *hits, int maxHits, int *counts);
+
+#endif /* XYARCHIVE_H */
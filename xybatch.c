@@ -0,0 +1,559 @@
+#define _POSIX_C_SOURCE 200809L
+#include "xybatch.h"
+#include "xycache.h"
+#include "xymask.h"
+#include "xyaccum.h"
+#include "xyraster.h"
+#include "xyparallel.h"
+#include "xydispatch.h"
+#include "xymonitor.h"
+#include "xyresolve.h"
+#include "xyunion.h"
+#include "xyprobe.h"
+#include "xyindex.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+int openEventSource(EventSource *src, FILE *in){
+    memset(src, 0, sizeof(EventSource));
+    src->in = in;
+    if (isArchive(in)) return (src->archive = openArchiveReader(in)) == NULL ? -1 : 0;
+    return openTextEventReader(&src->text, in);
+}
+
+int readEvent(EventSource *src, PixelHit **hits, int *hitCap, int *nHits){
+    if (src->archive != NULL) return readArchiveEvent(src->archive, hits, hitCap, nHits);
+    return readTextEvent(&src->text, hits, hitCap, nHits);
+}
+
+int64_t eventOffset(const EventSource *src, int *inBlock){
+    if (src->archive != NULL) return archiveEventOffset(src->archive, inBlock);
+    *inBlock = -1;
+    return src->text.lineOffset;
+}
+
+int seekEvent(EventSource *src, int64_t offset, int inBlock){
+    if (src->archive != NULL) return seekArchiveEvent(src->archive, offset, inBlock);
+    return seekTextEventReader(&src->text, offset);
+}
+
+void closeEventSource(EventSource *src){
+    closeArchiveReader(src->archive);
+    closeTextEventReader(&src->text);
+    memset(src, 0, sizeof(EventSource));
+}
+
+// The result cache only holds fillCentroids() results
+int greedyClustering(const BatchOptions *opt){
+    return opt->resolveTolerance <= 0 && !opt->unionClustering;
+}
+
+int eventBudget(const BatchOptions *opt, const PixelHit *hits, int nHits){
+    if (opt->workBudget <= 0) return BUDGET_FULL;
+    int n[3];
+    countHitColors(hits, nHits, n);
+    if ((long)n[0]*n[1] > opt->workBudget) return BUDGET_SKIPPED;
+    if ((long)n[0]*n[1] + (long)n[0]*n[2] + (long)n[1]*n[2] > opt->workBudget && opt->resolveTolerance <= 0)
+        return BUDGET_DEGRADED;
+    return BUDGET_FULL;
+}
+
+// Same selection and format as centroid.csv, prefixed with the event number
+int writeCentroids(TextBuffer *out, long event, const IntersectionPoint *centroids, int nCentroids, int budget){
+    int rows = 0;
+    for (int idx = 0; idx < nCentroids; idx++){
+        if (centroids[idx].num > -1 && centroids[idx].flag == 7){
+            rows++;
+            putInt(out, event);             // "%ld;%d;%d;%d;%.04f;%0.4f\n"
+            putChar(out, ';');
+            putInt(out, centroids[idx].num);
+            putChar(out, ';');
+            putInt(out, (int)centroids[idx].flag);
+            putChar(out, ';');
+            putInt(out, centroids[idx].intersects);
+            putChar(out, ';');
+            putFixed(out, centroids[idx].x, 4);
+            putChar(out, ';');
+            putFixed(out, centroids[idx].y, 4);
+            if (budget >= 0){
+                putChar(out, ';');
+                putInt(out, budget == BUDGET_DEGRADED);
+            }
+            putChar(out, '\n');
+        }
+    }
+    return rows;
+}
+
+typedef struct {
+    long event;
+    int hitOffset;                      // into Chunk.hits
+    int nHits;
+    int worker;                         // pool holding the centroids of the event
+    int outOffset;
+    int nOut;
+    int interCount;                     // -1 when the event failed
+    int budget;                         // BUDGET_* outcome
+    long cost;                          // estimated work, Y*R + Y*B + R*B pairs plus the hits
+    int64_t input;                      // position in the event file, see eventOffset()
+    int inBlock;
+    size_t membersOffset;               // into the members record pool of the worker
+    size_t membersSize;
+    int failed;
+} EventSlot;
+
+// Events read ahead and shared by the workers; output is written in event order once
+// the whole chunk is done. With several workers the events are handed out largest first
+// (order), so that the few big events of a chunk do not start last and leave the other
+// workers idle at the end of the chunk; the reordering stays within the chunk.
+typedef struct {
+    EventSlot *slots;
+    int nEvents;
+    int slotCap;
+    PixelHit *hits;
+    int nHits;
+    int hitCap;
+    int *order;                         // slots in dispatch order, NULL for the event order
+    int orderCap;
+    int next;                           // next event to hand out, under lock
+} Chunk;
+
+typedef struct {
+    const BatchOptions *opt;
+    ResultCache *cache;
+    pthread_mutex_t lock;               // dispatch counter and cache
+    Chunk chunk;
+    DispatchTuning tuning;
+    long degraded;                      // events over the work budget
+    long skipped;
+} BatchShared;
+
+typedef struct {
+    int id;
+    BatchShared *shared;
+    EventResult res;
+    IntersectionPoint *out;             // centroids of the events of the current chunk
+    int nOut;
+    int outCap;
+    Accumulator *acc;
+    EventImage image;
+    ResolveWork *resolve;
+    unsigned char *members;             // membership records of the events of the current chunk
+    size_t membersSize;
+    size_t membersCap;
+} Worker;
+
+static int appendEvent(Chunk *chunk, long event, const PixelHit *hits, int nHits){
+    if (chunk->nEvents == chunk->slotCap){
+        int cap = chunk->slotCap ? 2*chunk->slotCap : 256;
+        EventSlot *slots = (EventSlot *)realloc(chunk->slots, cap * sizeof(EventSlot));
+        if (slots == NULL) return -1;
+        chunk->slots = slots;
+        chunk->slotCap = cap;
+    }
+    if (chunk->nHits + nHits > chunk->hitCap){
+        int cap = 2*(chunk->nHits + nHits);
+        PixelHit *h = (PixelHit *)realloc(chunk->hits, cap * sizeof(PixelHit));
+        if (h == NULL) return -1;
+        chunk->hits = h;
+        chunk->hitCap = cap;
+    }
+    EventSlot *slot = &chunk->slots[chunk->nEvents++];
+    memset(slot, 0, sizeof(EventSlot));
+    slot->event = event;
+    slot->hitOffset = chunk->nHits;
+    slot->nHits = nHits;
+    memcpy(chunk->hits + chunk->nHits, hits, nHits * sizeof(PixelHit));
+    chunk->nHits += nHits;
+    return 0;
+}
+
+static int keepCentroids(Worker *w, EventSlot *slot, const IntersectionPoint *centroids, int n){
+    if (w->nOut + n > w->outCap){
+        int cap = 2*(w->nOut + n);
+        IntersectionPoint *out = (IntersectionPoint *)realloc(w->out, cap * sizeof(IntersectionPoint));
+        if (out == NULL) return -1;
+        w->out = out;
+        w->outCap = cap;
+    }
+    memcpy(w->out + w->nOut, centroids, n * sizeof(IntersectionPoint));
+    slot->worker = w->id;
+    slot->outOffset = w->nOut;
+    slot->nOut = n;
+    w->nOut += n;
+    return 0;
+}
+
+static void appendMembers(Worker *w, const void *data, size_t n){
+    memcpy(w->members + w->membersSize, data, n);
+    w->membersSize += n;
+}
+
+// Membership record of the event just reconstructed, as laid out in xybatch.h
+static int keepMembers(Worker *w, EventSlot *slot){
+    EventResult *res = &w->res;
+    if (buildClusterMembers(res) != 0) return -1;
+    int32_t header[2] = {res->interCount, res->nClusters};
+    int64_t event = slot->event;
+    int nMembers = res->memberStart[res->nClusters];
+    size_t size = sizeof(event) + sizeof(header) + (res->nClusters + 1 + nMembers) * sizeof(int32_t)
+                + 2 * res->interCount * sizeof(uint16_t);
+    if (w->membersSize + size > w->membersCap){
+        size_t cap = 2*(w->membersSize + size);
+        unsigned char *m = (unsigned char *)realloc(w->members, cap);
+        if (m == NULL) return -1;
+        w->members = m;
+        w->membersCap = cap;
+    }
+    slot->worker = w->id;
+    slot->membersOffset = w->membersSize;
+    slot->membersSize = size;
+    appendMembers(w, &event, sizeof(event));
+    appendMembers(w, header, sizeof(header));
+    appendMembers(w, res->memberStart, (res->nClusters + 1) * sizeof(int32_t));
+    appendMembers(w, res->members, nMembers * sizeof(int32_t));
+    appendMembers(w, res->interStrips, 2 * res->interCount * sizeof(uint16_t));
+    return 0;
+}
+
+static int renderSlot(Worker *w, EventSlot *slot){
+    const BatchOptions *opt = w->shared->opt;
+    char path[4096];
+    if (w->image.rgb == NULL && initEventImage(&w->image, opt->renderWidth) != 0) return -1;
+    renderEvent(&w->image, &w->res);
+    snprintf(path, sizeof(path), "%s/event_%06ld.%s", opt->renderDir, slot->event, opt->renderPPM ? "ppm" : "png");
+    if ((opt->renderPPM ? writePPM(&w->image, path) : writePNG(&w->image, path)) != 0){
+        fprintf(stderr, "Cannot write %s\n", path);
+    }
+    return 0;
+}
+
+static int processEvent(Worker *w, EventSlot *slot){
+    BatchShared *sh = w->shared;
+    const PixelHit *hits = sh->chunk.hits + slot->hitOffset;
+    int nHits = slot->nHits;
+    int threshold = selThreshold(nHits);
+    const IntersectionPoint *centroids = NULL;
+    int nCentroids = -1;
+    slot->interCount = -1;
+    slot->budget = eventBudget(sh->opt, hits, nHits);
+    w->res.event = slot->event;
+
+    // a display or the membership needs the strips and intersections, which the cache does not keep
+    if (sh->cache && sh->opt->renderDir == NULL && sh->opt->membersFile == NULL && greedyClustering(sh->opt)
+        && slot->budget == BUDGET_FULL){
+        const IntersectionPoint *stored;
+        pthread_mutex_lock(&sh->lock);
+        int nStored = lookupResultCache(sh->cache, hits, nHits, threshold, &stored, &slot->interCount);
+        int rc = nStored >= 0 ? keepCentroids(w, slot, stored, nStored) : 0;
+        pthread_mutex_unlock(&sh->lock);
+        if (rc != 0) return -1;
+        if (nStored >= 0){
+            centroids = w->out + slot->outOffset;
+            nCentroids = nStored;
+        }
+    }
+    if (nCentroids < 0){
+        int rc;
+        if (slot->budget == BUDGET_SKIPPED){
+            w->res.nLines = w->res.y_size = w->res.r_size = w->res.b_size = 0;
+            w->res.interCount = w->res.nClusters = 0;
+            rc = 0;
+        }
+        else if (sh->opt->resolveTolerance > 0 || slot->budget == BUDGET_DEGRADED)
+            rc = resolveEvent(hits, nHits, sh->opt->resolveTolerance > 0 ? sh->opt->resolveTolerance : RESOLVE_TOLERANCE,
+                              &w->res, w->resolve);
+        else if (sh->opt->unionClustering)
+            rc = reconstructEventUnion(hits, nHits, threshold, &w->res, sh->opt->parallelThreads);
+        else if (sh->opt->parallelThreads == 0)
+            rc = reconstructDispatched(&sh->tuning, hits, nHits, threshold, &w->res);
+        else if (sh->opt->parallelMinHits > 0 && nHits >= sh->opt->parallelMinHits)
+            rc = reconstructEventParallel(hits, nHits, threshold, &w->res, sh->opt->parallelThreads);
+        else
+            rc = reconstructEvent(hits, nHits, threshold, &w->res);
+        if (rc != 0) return -1;
+        centroids = w->res.centroids;
+        nCentroids = w->res.nClusters;
+        slot->interCount = w->res.interCount;
+        if (sh->cache && greedyClustering(sh->opt) && slot->budget == BUDGET_FULL){
+            pthread_mutex_lock(&sh->lock);
+            storeResultCache(sh->cache, hits, nHits, threshold, centroids, nCentroids, w->res.interCount);
+            pthread_mutex_unlock(&sh->lock);
+        }
+        // the accumulate mode writes no rows, but the monitor publishes the centroids of every event
+        if ((w->acc == NULL || sh->opt->monitorName != NULL) && keepCentroids(w, slot, centroids, nCentroids) != 0)
+            return -1;
+    }
+    if (w->acc) accumulateEvent(w->acc, hits, nHits, centroids, nCentroids,
+                                slot->budget == BUDGET_SKIPPED ? -1 : slot->interCount);
+    if (sh->opt->membersFile != NULL && keepMembers(w, slot) != 0) return -1;
+    if (sh->opt->renderDir != NULL) return renderSlot(w, slot);
+    return 0;
+}
+
+static void *workerLoop(void *arg){
+    Worker *w = (Worker *)arg;
+    BatchShared *sh = w->shared;
+    for (;;){
+        pthread_mutex_lock(&sh->lock);
+        int i = sh->chunk.next++;
+        pthread_mutex_unlock(&sh->lock);
+        if (i >= sh->chunk.nEvents) break;
+        if (sh->chunk.order != NULL) i = sh->chunk.order[i];
+        if (processEvent(w, &sh->chunk.slots[i]) != 0) sh->chunk.slots[i].failed = 1;
+    }
+    return NULL;
+}
+
+static const EventSlot *sortedSlots;    // for compareCost(), set by scheduleChunk() on the reading thread
+
+// Larger cost first, then the event order
+static int compareCost(const void *a, const void *b){
+    const EventSlot *x = &sortedSlots[*(const int *)a], *y = &sortedSlots[*(const int *)b];
+    if (x->cost != y->cost) return x->cost < y->cost ? 1 : -1;
+    return (x->event > y->event) - (x->event < y->event);
+}
+
+// Cost of each event from its hit count per color, known before any line is built: the
+// intersections grow with the pairs of strips and the clustering faster than that, so the
+// pairs order the events by work. Falls back to the event order when out of memory.
+static void scheduleChunk(Chunk *chunk){
+    if (chunk->nEvents > chunk->orderCap){
+        int *order = (int *)realloc(chunk->order, chunk->slotCap * sizeof(int));
+        if (order == NULL){
+            free(chunk->order);
+            chunk->order = NULL;
+            chunk->orderCap = 0;
+            return;
+        }
+        chunk->order = order;
+        chunk->orderCap = chunk->slotCap;
+    }
+    for (int i = 0; i < chunk->nEvents; i++){
+        EventSlot *slot = &chunk->slots[i];
+        int n[3];
+        countHitColors(chunk->hits + slot->hitOffset, slot->nHits, n);
+        slot->cost = (long)n[0]*n[1] + (long)n[0]*n[2] + (long)n[1]*n[2] + slot->nHits;
+        chunk->order[i] = i;
+    }
+    sortedSlots = chunk->slots;
+    qsort(chunk->order, chunk->nEvents, sizeof(int), compareCost);
+}
+
+static void runChunk(BatchShared *sh, Worker *workers, int nWorkers){
+    pthread_t threads[nWorkers];
+    sh->chunk.next = 0;
+    for (int t = 0; t < nWorkers; t++) workers[t].nOut = 0, workers[t].membersSize = 0;
+    if (nWorkers > 1) scheduleChunk(&sh->chunk);
+    if (nWorkers == 1){
+        workerLoop(&workers[0]);
+        return;
+    }
+    int started = 0;
+    for (int t = 1; t < nWorkers; t++){
+        if (pthread_create(&threads[t], NULL, workerLoop, &workers[t]) != 0) break;
+        started = t;
+    }
+    workerLoop(&workers[0]);
+    for (int t = 1; t <= started; t++) pthread_join(threads[t], NULL);
+}
+
+// Index entry of the event, written before its rows; rows -1 when there is no output
+static int indexSlot(BatchShared *sh, EventSlot *slot, TextBuffer *out, int rows, FILE *index){
+    IndexEntry entry;
+    fillIndexEntry(&entry, sh->chunk.hits + slot->hitOffset, slot->nHits);
+    entry.input = slot->input;
+    entry.inBlock = slot->inBlock;
+    if (!slot->failed){
+        entry.interCount = slot->interCount;
+        entry.centroids3 = (int16_t)rows;
+        if (rows >= 0) entry.output = textOffset(out);
+    }
+    return writeIndexEntry(index, &entry);
+}
+
+static int finishChunk(BatchShared *sh, Worker *workers, TextBuffer *out, FILE *members, Monitor *monitor,
+                       long *event, OccupancyTracker *tracker, FILE *index){
+    int status = 0;
+    for (int i = 0; i < sh->chunk.nEvents; i++, (*event)++){
+        EventSlot *slot = &sh->chunk.slots[i];
+        if (slot->failed){
+            fprintf(stderr, "Out of memory in event %ld\n", *event);
+            if (monitor) publishMonitorEvent(monitor, *event, slot->nHits, -1, NULL, -1, BUDGET_FULL);
+            if (index != NULL) indexSlot(sh, slot, out, -1, index);
+            status = 1;
+            continue;
+        }
+        sh->degraded += slot->budget == BUDGET_DEGRADED;
+        sh->skipped += slot->budget == BUDGET_SKIPPED;
+        if (monitor)
+            publishMonitorEvent(monitor, *event, slot->nHits, slot->interCount,
+                                workers[slot->worker].out + slot->outOffset, slot->nOut, slot->budget);
+        if (sh->opt->accumulateFile == NULL){
+            const IntersectionPoint *centroids = workers[slot->worker].out + slot->outOffset;
+            if (index != NULL){
+                int rows = 0;
+                for (int k = 0; k < slot->nOut; k++) rows += centroids[k].num > -1 && centroids[k].flag == 7;
+                if (indexSlot(sh, slot, out, rows, index) != 0) status = 1;
+            }
+            XY_PROBE2(output_entry, *event, slot->nOut);
+            int rows = writeCentroids(out, *event, centroids, slot->nOut, sh->opt->workBudget > 0 ? slot->budget : -1);
+            XY_PROBE2(output_exit, *event, rows);
+            (void)rows;
+        }
+        else if (index != NULL && indexSlot(sh, slot, out, -1, index) != 0) status = 1;
+        if (members != NULL)
+            fwrite(workers[slot->worker].members + slot->membersOffset, 1, slot->membersSize, members);
+        // newly masked pixels change what a hit list reconstructs to, from the next chunk on
+        if (tracker && trackOccupancy(tracker, sh->chunk.hits + slot->hitOffset, slot->nHits) > 0 && sh->cache)
+            clearResultCache(sh->cache);
+    }
+    sh->chunk.nEvents = 0;
+    sh->chunk.nHits = 0;
+    return status;
+}
+
+int runBatch(FILE *in, FILE *out, const BatchOptions *opt){
+    PixelHit *hits = NULL; int hitCap = 0; int nHits = 0;
+    int nWorkers = opt->threads > 0 ? opt->threads : 1;
+    int chunkEvents = opt->chunkEvents > 0 ? opt->chunkEvents : 1024;
+    int status = 0;
+
+    BatchShared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.opt = opt;
+    pthread_mutex_init(&sh.lock, NULL);
+    Worker *workers = (Worker *)calloc(nWorkers, sizeof(Worker));
+    if (workers == NULL){
+        fprintf(stderr, "Cannot allocate the workers\n");
+        return 1;
+    }
+    for (int t = 0; t < nWorkers; t++){
+        workers[t].id = t;
+        workers[t].shared = &sh;
+        initEventResult(&workers[t].res);
+        if ((opt->resolveTolerance > 0 || opt->workBudget > 0) && (workers[t].resolve = createResolveWork()) == NULL){
+            fprintf(stderr, "Cannot allocate the workers\n");
+            status = 1;
+        }
+        if (opt->accumulateFile != NULL && (workers[t].acc = createAccumulator()) == NULL){
+            fprintf(stderr, "Cannot allocate the histograms\n");
+            status = 1;
+        }
+    }
+
+    if (opt->cacheBytes > 0 && (sh.cache = createResultCache(opt->cacheBytes)) == NULL){
+        fprintf(stderr, "Cannot allocate the result cache\n");
+        status = 1;
+    }
+
+    // the CPUs left by the workers go to the large events
+    if (opt->parallelThreads == 0 && greedyClustering(opt)){
+        int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (initDispatchTuning(&sh.tuning, opt->tuningFile, cpus > nWorkers ? cpus / nWorkers : 1) != 0) status = 1;
+        if (opt->tuningFile != NULL) printDispatchTuning(&sh.tuning, stderr);
+    }
+
+    OccupancyTracker *tracker = NULL;
+    if (opt->maskFile != NULL && loadPixelMask(opt->maskFile) != 0) status = 1;
+    if (opt->maxRate > 0){
+        tracker = createOccupancyTracker(opt->maskWindow > 0 ? opt->maskWindow : 10000, opt->maxRate);
+        if (tracker == NULL){
+            fprintf(stderr, "Cannot allocate the occupancy tracker\n");
+            status = 1;
+        }
+    }
+
+    FILE *members = NULL;
+    if (opt->membersFile != NULL){
+        uint32_t version = MEMBERS_VERSION;
+        if ((members = fopen(opt->membersFile, "wb")) == NULL){
+            perror(opt->membersFile);
+            status = 1;
+        } else {
+            fwrite(MEMBERS_MAGIC, 1, 4, members);
+            fwrite(&version, sizeof(version), 1, members);
+        }
+    }
+
+    Monitor *monitor = NULL;
+    if (opt->monitorName != NULL && (monitor = createMonitor(opt->monitorName)) == NULL) status = 1;
+    FILE *index = NULL;
+    if (opt->indexFile != NULL && (index = createIndexFile(opt->indexFile)) == NULL) status = 1;
+
+    TextBuffer text;
+    initTextBuffer(&text, out, TEXT_BUFFER_SIZE);
+    if (opt->accumulateFile == NULL)
+        putText(&text, opt->workBudget > 0 ? "event;numCluster;centroidFlag; centroid3Colors;x;y;degraded\n"
+                                           : "event;numCluster;centroidFlag; centroid3Colors;x;y\n");
+    EventSource src;
+    if (openEventSource(&src, in) != 0) status = 1;
+
+    long event = 0;
+    int rc = status == 0 ? 1 : 0;
+    while (rc != 0){
+        rc = readEvent(&src, &hits, &hitCap, &nHits);
+        if (rc < 0){
+            status = 1;
+            continue;
+        }
+        if (rc > 0 && appendEvent(&sh.chunk, event + sh.chunk.nEvents, hits, nHits) != 0){
+            fprintf(stderr, "Out of memory in event %ld\n", event + sh.chunk.nEvents);
+            status = 1;
+            break;
+        }
+        if (rc > 0){
+            EventSlot *slot = &sh.chunk.slots[sh.chunk.nEvents - 1];
+            slot->input = eventOffset(&src, &slot->inBlock);
+        }
+        if (sh.chunk.nEvents == chunkEvents || (rc == 0 && sh.chunk.nEvents > 0)){
+            runChunk(&sh, workers, nWorkers);
+            if (finishChunk(&sh, workers, &text, members, monitor, &event, tracker, index) != 0) status = 1;
+        }
+    }
+
+    freeTextBuffer(&text);
+    closeMonitor(monitor);
+    if (members != NULL && fclose(members) != 0){
+        perror(opt->membersFile);
+        status = 1;
+    }
+    if (index != NULL && fclose(index) != 0){
+        perror(opt->indexFile);
+        status = 1;
+    }
+    if (opt->accumulateFile != NULL && workers[0].acc != NULL){
+        for (int t = 1; t < nWorkers; t++) mergeAccumulator(workers[0].acc, workers[t].acc);
+        if (writeAccumulator(workers[0].acc, opt->accumulateFile) != 0) status = 1;
+    }
+    if (opt->workBudget > 0)
+        fprintf(stderr, "work budget %ld: %ld events degraded, %ld skipped\n", opt->workBudget, sh.degraded, sh.skipped);
+    if (sh.cache != NULL){
+        printCacheStats(sh.cache, stderr);
+        freeResultCache(sh.cache);
+    }
+    if (tracker != NULL){
+        printOccupancySummary(tracker, stderr);
+        freeOccupancyTracker(tracker);
+    }
+    if (opt->maskFile != NULL && savePixelMask(opt->maskFile) != 0) status = 1;
+    for (int t = 0; t < nWorkers; t++){
+        freeEventResult(&workers[t].res);
+        freeResolveWork(workers[t].resolve);
+        free(workers[t].out);
+        free(workers[t].acc);
+        freeEventImage(&workers[t].image);
+        free(workers[t].members);
+    }
+    free(workers);
+    free(sh.chunk.slots);
+    free(sh.chunk.hits);
+    free(sh.chunk.order);
+    pthread_mutex_destroy(&sh.lock);
+    free(hits);
+    closeEventSource(&src);
+    return status;
+}
@@ -0,0 +1,73 @@
+#ifndef XYBATCH_H
+#define XYBATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xypicmic.h"
+#include "xyarchive.h"
+#include "xytext.h"
+
+// Batch mode: one event per input line, "<numElements> <row> <col> <row> <col> ...",
+// as in data_example_6.txt. Empty lines and lines starting with '#' are skipped.
+
+typedef struct {
+    size_t cacheBytes;                  // 0 disables the result cache
+    const char *maskFile;               // hot pixel mask loaded at start and saved at the end
+    double maxRate;                     // auto-mask pixels above this occupancy, 0 disables
+    int maskWindow;                     // sliding window of the occupancy, in events
+    int threads;                        // worker threads, 1 when 0
+    int chunkEvents;                    // events read ahead and shared by the workers
+    const char *accumulateFile;         // histograms only, no per-event output
+    const char *renderDir;              // event displays written there when set
+    int renderPPM;                      // PPM instead of PNG
+    int renderWidth;                    // image width in pixels, 900 when 0
+    int parallelMinHits;                // events with at least this many hits are split across
+    int parallelThreads;                // parallelThreads threads; when 0 the path is chosen per event
+    const char *membersFile;            // binary cluster membership, see below
+    const char *tuningFile;             // crossovers of the per event dispatch (xydispatch.h)
+    const char *monitorName;            // shared memory feed for live monitoring (xymonitor.h)
+    double resolveTolerance;            // > 0: strip ownership resolution (xyresolve.h), no clustering
+    int unionClustering;                // connected components (xyunion.h) on parallelThreads threads
+    long workBudget;                    // > 0: pairwise intersections allowed per event, see eventBudget()
+    const char *indexFile;              // event index of the input and the output (xyindex.h)
+} BatchOptions;
+
+// Cluster membership file: "XYCM", uint32 version (1), then per event, in the host byte order,
+//   int64 event, int32 interCount, int32 nClusters,
+//   int32 memberStart[nClusters+1], int32 members[memberStart[nClusters]],
+//   uint16 strips[interCount][2]       (STRIP_ID(color, value), color 0 Y, 1 R, 2 B)
+// Events resolved by -A or degraded by the work budget have interCount 0 and nClusters empty
+// clusters (the resolved hits); skipped events have none.
+#define MEMBERS_MAGIC "XYCM"
+#define MEMBERS_VERSION 1
+
+// Events from a text file (read by xytext.h) or a compressed archive (xyarchive.h), told
+// apart by the first byte
+typedef struct {
+    FILE *in;
+    ArchiveReader *archive;
+    TextEventReader text;
+} EventSource;
+
+int openEventSource(EventSource *src, FILE *in);
+// Returns 1 when an event was read, 0 at end of input and -1 on a malformed event (reported on
+// stderr, the caller may continue with the next one)
+int readEvent(EventSource *src, PixelHit **hits, int *hitCap, int *nHits);
+void closeEventSource(EventSource *src);            // the FILE stays open
+// Position of the last event read: file offset of its line, or of its archive block with
+// *inBlock its place in the block (-1 for a text file). seekEvent() makes it the next one.
+int64_t eventOffset(const EventSource *src, int *inBlock);
+int seekEvent(EventSource *src, int64_t offset, int inBlock);
+int greedyClustering(const BatchOptions *opt);      // results the cache may hold
+
+// Per event work budget, known before any intersection is built: an event with more pairwise
+// intersections (Y*R + Y*B + R*B strips) than opt->workBudget takes strip ownership resolution
+// (xyresolve.h, about Y*R work) instead of the clustering, one with more Y-R crossings than
+// that is skipped. Returns BUDGET_FULL, BUDGET_DEGRADED or BUDGET_SKIPPED.
+int eventBudget(const BatchOptions *opt, const PixelHit *hits, int nHits);
+
+// budget >= 0 adds a last column, 1 for the rows of degraded events; returns the rows written
+int writeCentroids(TextBuffer *out, long event, const IntersectionPoint *centroids, int nCentroids, int budget);
+int runBatch(FILE *in, FILE *out, const BatchOptions *opt);
+
+#endif /* XYBATCH_H */
@@ -0,0 +1,236 @@
+#include "xycache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef struct CacheEntry {
+    uint64_t hash;
+    int threshold;
+    int nHits;
+    int nCentroids;
+    int interCount;
+    size_t bytes;
+    unsigned short *sequence;           // pixel indices in input order
+    IntersectionPoint *centroids;
+    struct CacheEntry *prev;            // LRU list, head is the most recently used
+    struct CacheEntry *next;
+    struct CacheEntry *chain;           // bucket chain
+} CacheEntry;
+
+struct ResultCache {
+    CacheEntry **buckets;
+    size_t nBuckets;                    // power of two
+    CacheEntry *head;
+    CacheEntry *tail;
+    unsigned short *scratch;            // canonical key and input sequence of the current event
+    int scratchCap;
+    CacheStats stats;
+};
+
+#define NO_PIXEL 0xFFFF
+
+static int compareKey(const void *a, const void *b){
+    return (int)*(const unsigned short *)a - (int)*(const unsigned short *)b;
+}
+
+// Writes the sorted, deduplicated pixel indices of the event into key (nHits entries
+// at most) and returns their number. Out of range hits are dropped.
+int canonicalHits(const PixelHit *hits, int nHits, unsigned short *key){
+    int n = 0;
+    for (int i = 0; i < nHits; i++){
+        if (hits[i].row < 0 || hits[i].row >= ROWS || hits[i].col < 0 || hits[i].col >= COLS) continue;
+        key[n++] = (unsigned short)(hits[i].row * COLS + hits[i].col);
+    }
+    qsort(key, n, sizeof(unsigned short), compareKey);
+    int m = 0;
+    for (int i = 0; i < n; i++){
+        if (m == 0 || key[i] != key[m-1]) key[m++] = key[i];
+    }
+    return m;
+}
+
+static uint64_t hashKey(const unsigned short *key, int nKey, int threshold){
+    uint64_t h = 1469598103934665603ULL;            // FNV-1a
+    for (int i = 0; i < nKey; i++){
+        h ^= key[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= (uint64_t)(unsigned int)threshold;
+    h *= 1099511628211ULL;
+    return h;
+}
+
+ResultCache *createResultCache(size_t maxBytes){
+    ResultCache *cache = (ResultCache *)calloc(1, sizeof(ResultCache));
+    if (cache == NULL) return NULL;
+    cache->nBuckets = 64;
+    cache->buckets = (CacheEntry **)calloc(cache->nBuckets, sizeof(CacheEntry *));
+    if (cache->buckets == NULL){
+        free(cache);
+        return NULL;
+    }
+    cache->stats.maxBytes = maxBytes;
+    cache->stats.bytes = cache->nBuckets * sizeof(CacheEntry *);
+    return cache;
+}
+
+void freeResultCache(ResultCache *cache){
+    if (cache == NULL) return;
+    CacheEntry *e = cache->head;
+    while (e != NULL){
+        CacheEntry *next = e->next;
+        free(e);
+        e = next;
+    }
+    free(cache->buckets);
+    free(cache->scratch);
+    free(cache);
+}
+
+// Drops every entry, e.g. when the pixel mask changes what a hit list reconstructs to
+void clearResultCache(ResultCache *cache){
+    CacheEntry *e = cache->head;
+    while (e != NULL){
+        CacheEntry *next = e->next;
+        cache->stats.bytes -= e->bytes;
+        free(e);
+        e = next;
+    }
+    memset(cache->buckets, 0, cache->nBuckets * sizeof(CacheEntry *));
+    cache->head = cache->tail = NULL;
+    cache->stats.entries = 0;
+}
+
+static void unlinkEntry(ResultCache *cache, CacheEntry *e){
+    if (e->prev) e->prev->next = e->next; else cache->head = e->next;
+    if (e->next) e->next->prev = e->prev; else cache->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void pushFront(ResultCache *cache, CacheEntry *e){
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head) cache->head->prev = e;
+    cache->head = e;
+    if (cache->tail == NULL) cache->tail = e;
+}
+
+static void evictTail(ResultCache *cache){
+    CacheEntry *e = cache->tail;
+    CacheEntry **link = &cache->buckets[e->hash & (cache->nBuckets-1)];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+    unlinkEntry(cache, e);
+    cache->stats.bytes -= e->bytes;
+    cache->stats.entries--;
+    cache->stats.evictions++;
+    free(e);
+}
+
+static void growBuckets(ResultCache *cache){
+    size_t nBuckets = cache->nBuckets * 2;
+    CacheEntry **buckets = (CacheEntry **)calloc(nBuckets, sizeof(CacheEntry *));
+    if (buckets == NULL) return;                    // keep the old table, chains just get longer
+    for (CacheEntry *e = cache->head; e != NULL; e = e->next){
+        size_t b = e->hash & (nBuckets-1);
+        e->chain = buckets[b];
+        buckets[b] = e;
+    }
+    free(cache->buckets);
+    cache->stats.bytes += (nBuckets - cache->nBuckets) * sizeof(CacheEntry *);
+    cache->buckets = buckets;
+    cache->nBuckets = nBuckets;
+}
+
+// Fills the scratch buffer with the input sequence followed by the canonical key and
+// returns the hash of the canonical key, or 0 with *nKey = -1 when out of memory.
+static uint64_t prepareKey(ResultCache *cache, const PixelHit *hits, int nHits, int threshold, int *nKey){
+    if (2*nHits > cache->scratchCap){
+        unsigned short *s = (unsigned short *)realloc(cache->scratch, 2*nHits * sizeof(unsigned short));
+        if (s == NULL){
+            *nKey = -1;
+            return 0;
+        }
+        cache->scratch = s;
+        cache->scratchCap = 2*nHits;
+    }
+    for (int i = 0; i < nHits; i++){
+        int inRange = hits[i].row >= 0 && hits[i].row < ROWS && hits[i].col >= 0 && hits[i].col < COLS;
+        cache->scratch[i] = inRange ? (unsigned short)(hits[i].row * COLS + hits[i].col) : NO_PIXEL;
+    }
+    *nKey = canonicalHits(hits, nHits, cache->scratch + nHits);
+    return hashKey(cache->scratch + nHits, *nKey, threshold);
+}
+
+static CacheEntry *findEntry(ResultCache *cache, uint64_t h, int nHits, int threshold){
+    for (CacheEntry *e = cache->buckets[h & (cache->nBuckets-1)]; e != NULL; e = e->chain){
+        if (e->hash == h && e->threshold == threshold && e->nHits == nHits
+            && memcmp(e->sequence, cache->scratch, nHits * sizeof(unsigned short)) == 0){
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Returns the number of stored centroids and points *centroids at them, or -1 on a miss.
+// The pointer stays valid until the next store into the cache.
+int lookupResultCache(ResultCache *cache, const PixelHit *hits, int nHits, int threshold, const IntersectionPoint **centroids,
+                      int *interCount){
+    int nKey;
+    uint64_t h = prepareKey(cache, hits, nHits, threshold, &nKey);
+    CacheEntry *e = nKey < 0 ? NULL : findEntry(cache, h, nHits, threshold);
+    if (e == NULL){
+        cache->stats.misses++;
+        return -1;
+    }
+    unlinkEntry(cache, e);
+    pushFront(cache, e);
+    cache->stats.hits++;
+    *centroids = e->centroids;
+    if (interCount != NULL) *interCount = e->interCount;
+    return e->nCentroids;
+}
+
+void storeResultCache(ResultCache *cache, const PixelHit *hits, int nHits, int threshold, const IntersectionPoint *centroids,
+                      int nCentroids, int interCount){
+    // entry, centroids and hit sequence share a single allocation
+    size_t bytes = sizeof(CacheEntry) + nCentroids * sizeof(IntersectionPoint) + nHits * sizeof(unsigned short);
+    if (bytes > cache->stats.maxBytes) return;
+    int nKey;
+    uint64_t h = prepareKey(cache, hits, nHits, threshold, &nKey);
+    if (nKey < 0 || findEntry(cache, h, nHits, threshold) != NULL) return;
+    while (cache->tail != NULL && cache->stats.bytes + bytes > cache->stats.maxBytes) evictTail(cache);
+
+    CacheEntry *e = (CacheEntry *)malloc(bytes);
+    if (e == NULL) return;
+    e->hash = h;
+    e->threshold = threshold;
+    e->nHits = nHits;
+    e->nCentroids = nCentroids;
+    e->interCount = interCount;
+    e->bytes = bytes;
+    e->centroids = (IntersectionPoint *)(e + 1);
+    e->sequence = (unsigned short *)(e->centroids + nCentroids);
+    memcpy(e->centroids, centroids, nCentroids * sizeof(IntersectionPoint));
+    memcpy(e->sequence, cache->scratch, nHits * sizeof(unsigned short));
+
+    size_t b = e->hash & (cache->nBuckets-1);
+    e->chain = cache->buckets[b];
+    cache->buckets[b] = e;
+    pushFront(cache, e);
+    cache->stats.bytes += bytes;
+    cache->stats.entries++;
+    if (cache->stats.entries > cache->nBuckets) growBuckets(cache);
+}
+
+CacheStats getCacheStats(const ResultCache *cache){
+    return cache->stats;
+}
+
+void printCacheStats(const ResultCache *cache, FILE *out){
+    const CacheStats *s = &cache->stats;
+    unsigned long lookups = s->hits + s->misses;
+    fprintf(out, "cache: hits=%lu misses=%lu hitRate=%.1f%% entries=%lu evictions=%lu bytes=%zu/%zu\n",
+            s->hits, s->misses, lookups ? 100.0*s->hits/lookups : 0.0,
+            s->entries, s->evictions, s->bytes, s->maxBytes);
+}
@@ -0,0 +1,36 @@
+#ifndef XYCACHE_H
+#define XYCACHE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xypicmic.h"
+
+// Bounded LRU cache of reconstructed centroids, keyed by a hash of the canonical hit set
+// (pixel indices row*COLS+col, sorted and deduplicated) and the clustering threshold.
+// The greedy clustering of fillCentroids() depends on the order of the hits, so an entry
+// only answers events whose hits arrive in the same order as the one that filled it.
+
+typedef struct ResultCache ResultCache;
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long entries;
+    size_t bytes;
+    size_t maxBytes;
+} CacheStats;
+
+int canonicalHits(const PixelHit *hits, int nHits, unsigned short *key);
+ResultCache *createResultCache(size_t maxBytes);
+void freeResultCache(ResultCache *cache);
+void clearResultCache(ResultCache *cache);
+// An entry keeps the centroids and the intersection count of the event (*interCount, when not NULL)
+int lookupResultCache(ResultCache *cache, const PixelHit *hits, int nHits, int threshold, const IntersectionPoint **centroids,
+                      int *interCount);
+void storeResultCache(ResultCache *cache, const PixelHit *hits, int nHits, int threshold, const IntersectionPoint *centroids,
+                      int nCentroids, int interCount);
+CacheStats getCacheStats(const ResultCache *cache);
+void printCacheStats(const ResultCache *cache, FILE *out);
+
+#endif /* XYCACHE_H */
@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+#include "xydispatch.h"
+#include "xyparallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CALIBRATION_EVENTS 4            // different events per size
+#define CALIBRATION_REPEATS 3           // best of
+#define CALIBRATION_MAX_HITS 384
+#define CALIBRATION_SLOW 0.002          // seconds per event of the best path: stop growing the events
+#define CALIBRATION_LOSING 10.0
+
+const char *strategyNames[N_STRATEGIES] = {"brute", "grid", "parallel"};
+
+// Until a calibration or a tuning file says otherwise, every event goes through reconstructEvent()
+void defaultDispatchTuning(DispatchTuning *tuning, int threads){
+    tuning->gridFrom = -1;
+    tuning->parallelFrom = -1;
+    tuning->threads = threads;
+}
+
+int loadDispatchTuning(DispatchTuning *tuning, const char *path){
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return 1;
+    char line[256];
+    int status = 0;
+    while (fgets(line, sizeof(line), f) != NULL){
+        char key[64];
+        long value;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%63s %ld", key, &value) != 2){
+            fprintf(stderr, "Invalid tuning line: %s", line);
+            status = -1;
+        }
+        else if (strcmp(key, "gridFrom") == 0) tuning->gridFrom = value;
+        else if (strcmp(key, "parallelFrom") == 0) tuning->parallelFrom = value;
+        else if (strcmp(key, "threads") == 0) tuning->threads = (int)value;
+    }
+    fclose(f);
+    return status;
+}
+
+int saveDispatchTuning(const DispatchTuning *tuning, const char *path){
+    FILE *f = fopen(path, "w");
+    if (f == NULL){
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "# crossovers in Y-R + Y-B + R-B pairs per event, -1 never\n");
+    fprintf(f, "gridFrom %ld\nparallelFrom %ld\nthreads %d\n", tuning->gridFrom, tuning->parallelFrom, tuning->threads);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+void printDispatchTuning(const DispatchTuning *tuning, FILE *out){
+    fprintf(out, "dispatch: grid from %ld pairs, parallel (%d threads) from %ld pairs\n",
+            tuning->gridFrom, tuning->threads, tuning->parallelFrom);
+}
+
+// Hits per color as fillLinesFromHits() will see them (out of range, masked and dummy cells left out)
+void countHitColors(const PixelHit *hits, int nHits, int counts[3]){
+    counts[0] = counts[1] = counts[2] = 0;
+    for (int i = 0; i < nHits; i++){
+        int row = hits[i].row, col = hits[i].col;
+        if (row < 0 || row >= ROWS || col < 0 || col >= COLS || PIXEL_MASKED(row, col)) continue;
+        int color = assign_number(arr[row][col][0]);
+        if (color >= 0) counts[color]++;
+    }
+}
+
+static long pairCount(const int counts[3]){
+    return (long)counts[0]*counts[1] + (long)counts[0]*counts[2] + (long)counts[1]*counts[2];
+}
+
+Strategy chooseStrategy(const DispatchTuning *tuning, const int counts[3]){
+    long pairs = pairCount(counts);
+    if (tuning->threads > 1 && tuning->parallelFrom >= 0 && pairs >= tuning->parallelFrom) return STRATEGY_PARALLEL;
+    if (tuning->gridFrom >= 0 && pairs >= tuning->gridFrom) return STRATEGY_GRID;
+    return STRATEGY_BRUTE;
+}
+
+static int runStrategy(Strategy s, int threads, const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    switch (s){
+        case STRATEGY_GRID:
+            return reconstructEventGrid(hits, nHits, threshold, res);
+        case STRATEGY_PARALLEL:
+            return reconstructEventParallel(hits, nHits, threshold, res, threads);
+        default:
+            return reconstructEvent(hits, nHits, threshold, res);
+    }
+}
+
+int reconstructDispatched(const DispatchTuning *tuning, const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    int counts[3];
+    countHitColors(hits, nHits, counts);
+    return runStrategy(chooseStrategy(tuning, counts), tuning->threads, hits, nHits, threshold, res);
+}
+
+// ----------------------------------------------------------------
+// calibration: random events of growing size, every path timed on the same events
+// ----------------------------------------------------------------
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static void randomEvent(PixelHit *hits, int nHits, unsigned int *seed){
+    for (int i = 0; i < nHits; i++){
+        do {
+            *seed = *seed * 1103515245u + 12345u;
+            hits[i].row = (int)((*seed >> 8) % ROWS);
+            *seed = *seed * 1103515245u + 12345u;
+            hits[i].col = (int)((*seed >> 8) % COLS);
+        } while (arr[hits[i].row][hits[i].col][0] == 'D');
+    }
+}
+
+// Seconds per event of each path still in the race (-1 for the others), best of CALIBRATION_REPEATS
+static int timeStrategies(int nHits, int threads, const int alive[N_STRATEGIES], EventResult *res,
+                          double seconds[N_STRATEGIES], long *pairs){
+    PixelHit hits[CALIBRATION_EVENTS][CALIBRATION_MAX_HITS];
+    unsigned int seed = 12345u + (unsigned int)nHits;
+    *pairs = 0;
+    for (int e = 0; e < CALIBRATION_EVENTS; e++){
+        int counts[3];
+        randomEvent(hits[e], nHits, &seed);
+        countHitColors(hits[e], nHits, counts);
+        *pairs += pairCount(counts);
+    }
+    *pairs /= CALIBRATION_EVENTS;
+    for (int s = 0; s < N_STRATEGIES; s++){
+        seconds[s] = -1;
+        if (!alive[s]) continue;
+        for (int rep = 0; rep < CALIBRATION_REPEATS; rep++){
+            double t0 = now();
+            for (int e = 0; e < CALIBRATION_EVENTS; e++)
+                if (runStrategy((Strategy)s, threads, hits[e], nHits, selThreshold(nHits), res) != 0) return -1;
+            double t = (now() - t0) / CALIBRATION_EVENTS;
+            if (seconds[s] < 0 || t < seconds[s]) seconds[s] = t;
+        }
+    }
+    return 0;
+}
+
+// The crossover of a path is the smallest measured size from which it stays faster than the
+// paths before it. A path CALIBRATION_LOSING times slower than the best is not timed on larger
+// events (it never wins), and the sizes grow until the best path needs CALIBRATION_SLOW.
+void calibrateDispatch(DispatchTuning *tuning, int threads){
+    EventResult res;
+    initEventResult(&res);
+    res.event = -1;                     // calibration events, as seen by the tracepoints
+    int alive[N_STRATEGIES] = {1, 1, threads > 1};
+    long from[N_STRATEGIES] = {0, -1, -1};
+    for (int nHits = 6; nHits <= CALIBRATION_MAX_HITS; nHits *= 2){
+        double seconds[N_STRATEGIES];
+        long pairs;
+        if (timeStrategies(nHits, threads, alive, &res, seconds, &pairs) != 0) break;
+        double best = seconds[STRATEGY_BRUTE];
+        for (int s = 1; s < N_STRATEGIES; s++){
+            if (seconds[s] >= 0 && seconds[s] < best){
+                if (from[s] < 0) from[s] = pairs;
+                best = seconds[s];
+            } else from[s] = -1;
+        }
+        for (int s = 1; s < N_STRATEGIES; s++)
+            if (seconds[s] > CALIBRATION_LOSING * best) alive[s] = 0;
+        if (best > CALIBRATION_SLOW) break;
+    }
+    tuning->threads = threads;
+    tuning->gridFrom = from[STRATEGY_GRID];
+    tuning->parallelFrom = from[STRATEGY_PARALLEL];
+    freeEventResult(&res);
+}
+
+// Tuning of this run: none without a file (every event through reconstructEvent(), no
+// calibration), from the file when it exists, else calibrated here and saved to it, so only
+// the first run with that file pays for the calibration. "-" calibrates without saving.
+// threads is the parallel path budget, 0 for the online CPUs.
+int initDispatchTuning(DispatchTuning *tuning, const char *path, int threads){
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    defaultDispatchTuning(tuning, threads);
+    if (path == NULL) return 0;
+    int rc = strcmp(path, "-") != 0 ? loadDispatchTuning(tuning, path) : 1;
+    if (rc < 0) return -1;
+    if (rc > 0){
+        calibrateDispatch(tuning, threads);
+        if (strcmp(path, "-") != 0 && saveDispatchTuning(tuning, path) != 0) return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef XYDISPATCH_H
+#define XYDISPATCH_H
+
+#include "xypicmic.h"
+
+// Per event choice of the reconstruction path from the hit count of each color. All paths give
+// the same result; they differ in cost with the number of Y-R, Y-B and R-B pairs:
+//   STRATEGY_BRUTE     reconstructEvent(), all distance pairs (small events)
+//   STRATEGY_GRID      reconstructEventGrid(), spatial grid on one thread
+//   STRATEGY_PARALLEL  reconstructEventParallel() on `threads` threads (very large events)
+
+typedef enum {
+    STRATEGY_BRUTE,
+    STRATEGY_GRID,
+    STRATEGY_PARALLEL,
+    N_STRATEGIES
+} Strategy;
+
+typedef struct {
+    long gridFrom;                      // pairs from which each path wins, -1 never
+    long parallelFrom;
+    int threads;                        // threads of the parallel path
+} DispatchTuning;
+
+extern const char *strategyNames[N_STRATEGIES];
+
+void defaultDispatchTuning(DispatchTuning *tuning, int threads);
+int loadDispatchTuning(DispatchTuning *tuning, const char *path);  // 1 if the file does not exist
+int saveDispatchTuning(const DispatchTuning *tuning, const char *path);
+void calibrateDispatch(DispatchTuning *tuning, int threads);
+int initDispatchTuning(DispatchTuning *tuning, const char *path, int threads);
+void printDispatchTuning(const DispatchTuning *tuning, FILE *out);
+
+void countHitColors(const PixelHit *hits, int nHits, int counts[3]);
+Strategy chooseStrategy(const DispatchTuning *tuning, const int counts[3]);
+int reconstructDispatched(const DispatchTuning *tuning, const PixelHit *hits, int nHits, int threshold, EventResult *res);
+
+#endif /* XYDISPATCH_H */
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "xyformat.h"
+
+#define FIELD_MAX 400                   // longest field, "%.9f" of DBL_MAX included
+
+static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+void initTextBuffer(TextBuffer *tb, FILE *out, size_t cap){
+    tb->out = out;
+    tb->len = 0;
+    tb->written = 0;
+    tb->buf = cap > sizeof(tb->local) ? (char *)malloc(cap) : NULL;
+    if (tb->buf != NULL){
+        tb->cap = cap;
+    } else {
+        tb->buf = tb->local;
+        tb->cap = sizeof(tb->local);
+    }
+}
+
+void flushTextBuffer(TextBuffer *tb){
+    if (tb->len > 0) fwrite(tb->buf, 1, tb->len, tb->out);
+    tb->written += (long)tb->len;
+    tb->len = 0;
+}
+
+void freeTextBuffer(TextBuffer *tb){
+    flushTextBuffer(tb);
+    if (tb->buf != tb->local) free(tb->buf);
+    tb->buf = tb->local;
+    tb->cap = sizeof(tb->local);
+}
+
+long textOffset(const TextBuffer *tb){
+    return tb->written + (long)tb->len;
+}
+
+// Room for n more characters
+static char *reserve(TextBuffer *tb, size_t n){
+    if (tb->len + n > tb->cap) flushTextBuffer(tb);
+    return tb->buf + tb->len;
+}
+
+void putText(TextBuffer *tb, const char *s){
+    size_t n = strlen(s);
+    if (n > tb->cap){
+        flushTextBuffer(tb);
+        fwrite(s, 1, n, tb->out);
+        tb->written += (long)n;
+        return;
+    }
+    memcpy(reserve(tb, n), s, n);
+    tb->len += n;
+}
+
+void putChar(TextBuffer *tb, char c){
+    *reserve(tb, 1) = c;
+    tb->len++;
+}
+
+static char *putDigits(char *p, unsigned long long n){
+    char tmp[20];
+    int k = 0;
+    do {
+        tmp[k++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n > 0);
+    while (k > 0) *p++ = tmp[--k];
+    return p;
+}
+
+void putInt(TextBuffer *tb, long v){
+    char *p = reserve(tb, 21);
+    char *start = p;
+    unsigned long long n = (unsigned long long)v;
+    if (v < 0){
+        *p++ = '-';
+        n = 0 - n;
+    }
+    p = putDigits(p, n);
+    tb->len += (size_t)(p - start);
+}
+
+// v*10^decimals rounded to the nearest integer exactly like printf: the product is split
+// in p + err with fma() so the halfway cases are decided on the exact value (ties to even).
+void putFixed(TextBuffer *tb, double v, int decimals){
+    double a = fabs(v);
+    if (decimals < 0 || decimals > 9 || !(a * powersOf10[decimals] < 1e15)){
+        char *p = reserve(tb, FIELD_MAX);
+        int n = snprintf(p, FIELD_MAX, "%.*f", decimals, v);
+        if (n > 0) tb->len += (size_t)(n < FIELD_MAX ? n : FIELD_MAX - 1);
+        return;
+    }
+    double scale = powersOf10[decimals];
+    double prod = a * scale;
+    double err = fma(a, scale, -prod);
+    double whole = floor(prod);
+    unsigned long long n = (unsigned long long)whole;
+    double above = ((prod - whole) - 0.5) + err;
+    if (above > 0 || (above == 0 && (n & 1))) n++;
+
+    unsigned long long unit = (unsigned long long)scale;
+    char *p = reserve(tb, 40);
+    char *start = p;
+    if (signbit(v)) *p++ = '-';
+    p = putDigits(p, n / unit);
+    if (decimals > 0){
+        unsigned long long frac = n % unit;
+        *p++ = '.';
+        for (int k = decimals - 1; k >= 0; k--){
+            p[k] = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        p += decimals;
+    }
+    tb->len += (size_t)(p - start);
+}
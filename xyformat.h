@@ -0,0 +1,31 @@
+#ifndef XYFORMAT_H
+#define XYFORMAT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Text output without printf: fields are formatted straight into a large buffer that is
+// handed to the FILE in big chunks. putFixed() gives the same characters as "%.<n>f".
+
+#define TEXT_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+    FILE *out;
+    char *buf;
+    size_t len;
+    size_t cap;
+    long written;                       // bytes handed to out so far
+    char local[512];                    // used when the large buffer cannot be allocated
+} TextBuffer;
+
+void initTextBuffer(TextBuffer *tb, FILE *out, size_t cap);
+void flushTextBuffer(TextBuffer *tb);
+void freeTextBuffer(TextBuffer *tb);    // flushes first
+long textOffset(const TextBuffer *tb);  // characters put since initTextBuffer()
+
+void putText(TextBuffer *tb, const char *s);
+void putChar(TextBuffer *tb, char c);
+void putInt(TextBuffer *tb, long v);
+void putFixed(TextBuffer *tb, double v, int decimals);
+
+#endif /* XYFORMAT_H */
@@ -0,0 +1,453 @@
+#include "xyincr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define GRID_BUCKETS 1024               // power of two
+
+typedef struct {
+    double x;
+    double y;
+    int bit;                            // 0 YR, 1 YB, 2 RB as in fill_bits()
+    int line[2];
+    int cluster;
+    int posInCluster;
+    int cellX;
+    int cellY;
+    int cellNext;                       // next point of the grid bucket, -1 at the end
+} IncPoint;
+
+typedef struct {
+    LineCoordinates coords;
+    int pixel;
+    int color;
+    int posInColor;
+    int *points;
+    int nPoints;
+    int cap;
+} IncLine;
+
+typedef struct {
+    double sumX;
+    double sumY;
+    int bitCount[3];
+    int *members;
+    int nMembers;
+    int cap;
+} IncCluster;
+
+typedef struct {
+    int *slots;
+    int size;
+    int cap;
+} SlotList;
+
+struct IncrementalEvent {
+    int fixedThreshold;                 // 0: follow selThreshold(nHits)
+    int threshold;
+    int nHits;                          // all hits, dummy cells included, as selThreshold() counts them
+    int nPoints;
+    int nClusters;
+
+    IncLine *lines;       int lineSlots;    int lineCap;    SlotList freeLines;
+    IncPoint *points;     int pointSlots;   int pointCap;   SlotList freePoints;
+    IncCluster *clusters; int clusterSlots; int clusterCap; SlotList freeClusters;
+    int *byColor[3];    int colorSize[3]; int colorCap[3];
+    int grid[GRID_BUCKETS];
+    unsigned short pixelCount[NUM_PIXELS];
+    int *stack;         int stackCap;
+    unsigned char *seen; int seenCap;
+};
+
+// ----------------------------------------------------------------
+// small growable arrays and slot allocators
+// ----------------------------------------------------------------
+
+static int grow(void **array, int *cap, int need, size_t size){
+    if (need <= *cap) return 0;
+    int newCap = *cap ? *cap : 16;
+    while (newCap < need) newCap *= 2;
+    void *a = realloc(*array, newCap * size);
+    if (a == NULL) return -1;
+    *array = a;
+    *cap = newCap;
+    return 0;
+}
+
+static int pushInt(int **array, int *size, int *cap, int value){
+    if (grow((void **)array, cap, *size + 1, sizeof(int)) != 0) return -1;
+    (*array)[(*size)++] = value;
+    return 0;
+}
+
+// Returns a slot index, recycled from the free list or appended (zeroed), -1 when out of memory
+static int takeSlot(void **array, int *slots, int *cap, SlotList *freeList, size_t size){
+    if (freeList->size > 0) return freeList->slots[--freeList->size];
+    if (grow(array, cap, *slots + 1, size) != 0) return -1;
+    memset((char *)*array + *slots * size, 0, size);
+    return (*slots)++;
+}
+
+// Puts a slot back on the free list
+static int releaseSlot(SlotList *freeList, int slot){
+    return pushInt(&freeList->slots, &freeList->size, &freeList->cap, slot);
+}
+
+// ----------------------------------------------------------------
+// spatial grid, cell size = threshold
+// ----------------------------------------------------------------
+
+static unsigned int bucketOf(int cx, int cy){
+    return ((unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u) & (GRID_BUCKETS-1);
+}
+
+static void gridInsert(IncrementalEvent *ev, int p){
+    IncPoint *pt = &ev->points[p];
+    pt->cellX = (int)floor(pt->x / ev->threshold);
+    pt->cellY = (int)floor(pt->y / ev->threshold);
+    unsigned int b = bucketOf(pt->cellX, pt->cellY);
+    pt->cellNext = ev->grid[b];
+    ev->grid[b] = p;
+}
+
+static void gridRemove(IncrementalEvent *ev, int p){
+    int *link = &ev->grid[bucketOf(ev->points[p].cellX, ev->points[p].cellY)];
+    while (*link != p) link = &ev->points[*link].cellNext;
+    *link = ev->points[p].cellNext;
+}
+
+// Calls visit(ev, q, arg) for every point q != p closer than the threshold to p
+static int forNeighbors(IncrementalEvent *ev, int p, int (*visit)(IncrementalEvent *, int, void *), void *arg){
+    const IncPoint *pt = &ev->points[p];
+    for (int dy = -1; dy <= 1; dy++){
+        for (int dx = -1; dx <= 1; dx++){
+            int cx = pt->cellX + dx, cy = pt->cellY + dy;
+            for (int q = ev->grid[bucketOf(cx, cy)]; q >= 0; q = ev->points[q].cellNext){
+                const IncPoint *o = &ev->points[q];
+                if (q == p || o->cellX != cx || o->cellY != cy) continue;
+                if (distance(pt->x, pt->y, o->x, o->y) < ev->threshold){
+                    if (visit(ev, q, arg) != 0) return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------
+// clusters
+// ----------------------------------------------------------------
+
+static int newCluster(IncrementalEvent *ev){
+    int c = takeSlot((void **)&ev->clusters, &ev->clusterSlots, &ev->clusterCap, &ev->freeClusters, sizeof(IncCluster));
+    if (c < 0) return -1;
+    IncCluster *cl = &ev->clusters[c];
+    cl->sumX = cl->sumY = 0;
+    memset(cl->bitCount, 0, sizeof(cl->bitCount));
+    cl->nMembers = 0;
+    ev->nClusters++;
+    return c;
+}
+
+static int dropCluster(IncrementalEvent *ev, int c){
+    ev->clusters[c].nMembers = 0;
+    ev->nClusters--;
+    return releaseSlot(&ev->freeClusters, c);
+}
+
+static int joinCluster(IncrementalEvent *ev, int c, int p){
+    IncCluster *cl = &ev->clusters[c];
+    if (grow((void **)&cl->members, &cl->cap, cl->nMembers + 1, sizeof(int)) != 0) return -1;
+    IncPoint *pt = &ev->points[p];
+    pt->cluster = c;
+    pt->posInCluster = cl->nMembers;
+    cl->members[cl->nMembers++] = p;
+    cl->sumX += pt->x;
+    cl->sumY += pt->y;
+    cl->bitCount[pt->bit]++;
+    return 0;
+}
+
+static void leaveCluster(IncrementalEvent *ev, int p){
+    IncPoint *pt = &ev->points[p];
+    IncCluster *cl = &ev->clusters[pt->cluster];
+    int last = cl->members[--cl->nMembers];
+    cl->members[pt->posInCluster] = last;
+    ev->points[last].posInCluster = pt->posInCluster;
+    cl->sumX -= pt->x;
+    cl->sumY -= pt->y;
+    cl->bitCount[pt->bit]--;
+    pt->cluster = -1;
+}
+
+// Moves every member of the smaller cluster into the larger one, returns the survivor
+static int mergeClusters(IncrementalEvent *ev, int a, int b){
+    if (ev->clusters[a].nMembers < ev->clusters[b].nMembers){
+        int t = a; a = b; b = t;
+    }
+    while (ev->clusters[b].nMembers > 0){
+        int p = ev->clusters[b].members[ev->clusters[b].nMembers - 1];
+        leaveCluster(ev, p);
+        if (joinCluster(ev, a, p) != 0) return -1;
+    }
+    return dropCluster(ev, b) == 0 ? a : -1;
+}
+
+static int linkNeighbor(IncrementalEvent *ev, int q, void *arg){
+    int *target = (int *)arg;           // target[0] = new point, target[1] = its cluster
+    int cq = ev->points[q].cluster;
+    if (cq == target[1]) return 0;
+    int merged = mergeClusters(ev, target[1], cq);
+    if (merged < 0) return -1;
+    target[1] = merged;
+    return 0;
+}
+
+static int clusterPoint(IncrementalEvent *ev, int p){
+    int c = newCluster(ev);
+    if (c < 0 || joinCluster(ev, c, p) != 0) return -1;
+    gridInsert(ev, p);
+    int target[2] = {p, c};
+    return forNeighbors(ev, p, linkNeighbor, target);
+}
+
+static int pushUnseen(IncrementalEvent *ev, int q, void *arg){
+    int *top = (int *)arg;
+    if (ev->seen[q]) return 0;
+    ev->seen[q] = 1;
+    if (grow((void **)&ev->stack, &ev->stackCap, *top + 1, sizeof(int)) != 0) return -1;
+    ev->stack[(*top)++] = q;
+    return 0;
+}
+
+// After points left cluster c, splits what remains into connected components
+static int splitCluster(IncrementalEvent *ev, int c){
+    IncCluster *cl = &ev->clusters[c];
+    if (cl->nMembers == 0) return dropCluster(ev, c);
+    if (grow((void **)&ev->seen, &ev->seenCap, ev->pointSlots, 1) != 0) return -1;
+    for (int i = 0; i < cl->nMembers; i++) ev->seen[cl->members[i]] = 0;
+
+    // members are moved out one component at a time; the first component reuses c
+    int nLeft = cl->nMembers;
+    int *pending = (int *)malloc(nLeft * sizeof(int));
+    if (pending == NULL) return -1;
+    memcpy(pending, cl->members, nLeft * sizeof(int));
+    cl->nMembers = 0;
+    cl->sumX = cl->sumY = 0;
+    memset(cl->bitCount, 0, sizeof(cl->bitCount));
+
+    int status = 0, target = c;
+    for (int i = 0; i < nLeft && status == 0; i++){
+        int seed = pending[i];
+        if (ev->seen[seed]) continue;
+        if (target < 0 && (target = newCluster(ev)) < 0){
+            status = -1;
+            break;
+        }
+        int top = 0;
+        status = pushUnseen(ev, seed, &top);
+        while (status == 0 && top > 0){
+            int p = ev->stack[--top];
+            status = joinCluster(ev, target, p);
+            if (status == 0) status = forNeighbors(ev, p, pushUnseen, &top);
+        }
+        target = -1;
+    }
+    free(pending);
+    return status;
+}
+
+static int reclusterAll(IncrementalEvent *ev){
+    for (int b = 0; b < GRID_BUCKETS; b++) ev->grid[b] = -1;
+    for (int c = 0; c < ev->clusterSlots; c++){
+        if (ev->clusters[c].nMembers > 0 && dropCluster(ev, c) != 0) return -1;
+    }
+    for (int l = 0; l < ev->lineSlots; l++){
+        const IncLine *line = &ev->lines[l];
+        if (line->pixel < 0) continue;
+        for (int k = 0; k < line->nPoints; k++){
+            int p = line->points[k];
+            if (ev->points[p].line[0] != l) continue;      // each point once, from its first line
+            if (clusterPoint(ev, p) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// Follows the selThreshold() band of the current hit count, reclustering when it moves
+static int updateThreshold(IncrementalEvent *ev){
+    int threshold = ev->fixedThreshold > 0 ? ev->fixedThreshold : selThreshold(ev->nHits);
+    if (threshold == ev->threshold) return 0;
+    ev->threshold = threshold;
+    return reclusterAll(ev);
+}
+
+// ----------------------------------------------------------------
+// public API
+// ----------------------------------------------------------------
+
+IncrementalEvent *createIncrementalEvent(int threshold){
+    IncrementalEvent *ev = (IncrementalEvent *)calloc(1, sizeof(IncrementalEvent));
+    if (ev == NULL) return NULL;
+    ev->fixedThreshold = threshold;
+    resetIncrementalEvent(ev);
+    return ev;
+}
+
+void freeIncrementalEvent(IncrementalEvent *ev){
+    if (ev == NULL) return;
+    for (int l = 0; l < ev->lineSlots; l++) free(ev->lines[l].points);
+    for (int c = 0; c < ev->clusterSlots; c++) free(ev->clusters[c].members);
+    for (int k = 0; k < 3; k++) free(ev->byColor[k]);
+    free(ev->lines); free(ev->freeLines.slots);
+    free(ev->points); free(ev->freePoints.slots);
+    free(ev->clusters); free(ev->freeClusters.slots);
+    free(ev->stack); free(ev->seen);
+    free(ev);
+}
+
+void resetIncrementalEvent(IncrementalEvent *ev){
+    for (int l = 0; l < ev->lineSlots; l++) free(ev->lines[l].points);
+    for (int c = 0; c < ev->clusterSlots; c++) free(ev->clusters[c].members);
+    ev->lineSlots = ev->pointSlots = ev->clusterSlots = 0;
+    ev->freeLines.size = ev->freePoints.size = ev->freeClusters.size = 0;
+    ev->nHits = ev->nPoints = ev->nClusters = 0;
+    for (int k = 0; k < 3; k++) ev->colorSize[k] = 0;
+    for (int b = 0; b < GRID_BUCKETS; b++) ev->grid[b] = -1;
+    memset(ev->pixelCount, 0, sizeof(ev->pixelCount));
+    ev->threshold = ev->fixedThreshold > 0 ? ev->fixedThreshold : selThreshold(0);
+}
+
+// Returns 0 when the hit added a strip, 1 for a dummy or masked cell (still counted for
+// the threshold), -1 when out of range and -2 when out of memory.
+int addHit(IncrementalEvent *ev, int row, int col){
+    if (row < 0 || row >= ROWS || col < 0 || col >= COLS) return -1;
+    int pixel = row*COLS + col;
+    ev->pixelCount[pixel]++;
+    ev->nHits++;
+    if (updateThreshold(ev) != 0) return -2;
+    int color = assign_number(arr[row][col][0]);
+    if (color < 0 || PIXEL_MASKED(row, col)) return 1;
+
+    int l = takeSlot((void **)&ev->lines, &ev->lineSlots, &ev->lineCap, &ev->freeLines, sizeof(IncLine));
+    if (l < 0) return -2;
+    IncLine *line = &ev->lines[l];
+    line->coords = calculateLineCoordinates(arr[row][col][0], atoi(&arr[row][col][1]));
+    line->pixel = pixel;
+    line->color = color;
+    line->nPoints = 0;
+    line->posInColor = ev->colorSize[color];
+    if (pushInt(&ev->byColor[color], &ev->colorSize[color], &ev->colorCap[color], l) != 0) return -2;
+
+    // only the pairs with the new strip are computed
+    for (int other = 0; other < 3; other++){
+        if (other == color) continue;
+        for (int i = 0; i < ev->colorSize[other]; i++){
+            int m = ev->byColor[other][i];
+            IntersectionPoint x = calculateIntersection(ev->lines[m].coords, line->coords);
+            int p = takeSlot((void **)&ev->points, &ev->pointSlots, &ev->pointCap, &ev->freePoints, sizeof(IncPoint));
+            if (p < 0) return -2;
+            IncPoint *pt = &ev->points[p];
+            pt->x = x.x;
+            pt->y = x.y;
+            pt->bit = x.flag == COMBINATION_YR ? 0 : x.flag == COMBINATION_YB ? 1 : 2;
+            pt->line[0] = m;
+            pt->line[1] = l;
+            pt->cluster = -1;
+            line = &ev->lines[l];
+            if (pushInt(&ev->lines[m].points, &ev->lines[m].nPoints, &ev->lines[m].cap, p) != 0) return -2;
+            if (pushInt(&line->points, &line->nPoints, &line->cap, p) != 0) return -2;
+            ev->nPoints++;
+            if (clusterPoint(ev, p) != 0) return -2;
+        }
+    }
+    return 0;
+}
+
+static void dropPointFromLine(IncLine *line, int p){
+    for (int k = 0; k < line->nPoints; k++){
+        if (line->points[k] == p){
+            line->points[k] = line->points[--line->nPoints];
+            return;
+        }
+    }
+}
+
+// Removes one hit of the pixel: its strip, its intersections, and splits the clusters
+// they belonged to. Returns 0 when removed, 1 when the pixel had no hit, -2 out of memory.
+int removeHit(IncrementalEvent *ev, int row, int col){
+    if (row < 0 || row >= ROWS || col < 0 || col >= COLS) return 1;
+    int pixel = row*COLS + col;
+    if (ev->pixelCount[pixel] == 0) return 1;
+    ev->pixelCount[pixel]--;
+    ev->nHits--;
+
+    int l = -1;
+    for (int i = 0; i < ev->lineSlots; i++){
+        if (ev->lines[i].pixel == pixel){
+            l = i;
+            break;
+        }
+    }
+    if (l >= 0){
+        IncLine *line = &ev->lines[l];
+        int *touched = (int *)malloc((line->nPoints + 1) * sizeof(int));
+        if (touched == NULL) return -2;
+        int nTouched = 0;
+        for (int k = 0; k < line->nPoints; k++){
+            int p = line->points[k];
+            IncPoint *pt = &ev->points[p];
+            int c = pt->cluster;
+            int known = 0;
+            for (int t = 0; t < nTouched; t++) known |= touched[t] == c;
+            if (!known) touched[nTouched++] = c;
+            leaveCluster(ev, p);
+            gridRemove(ev, p);
+            dropPointFromLine(&ev->lines[pt->line[0] == l ? pt->line[1] : pt->line[0]], p);
+            if (releaseSlot(&ev->freePoints, p) != 0){
+                free(touched);
+                return -2;
+            }
+            ev->nPoints--;
+        }
+        line->nPoints = 0;
+        line->pixel = -1;
+        int *byColor = ev->byColor[line->color];
+        int last = byColor[--ev->colorSize[line->color]];
+        byColor[line->posInColor] = last;
+        ev->lines[last].posInColor = line->posInColor;
+        int status = releaseSlot(&ev->freeLines, l);
+        for (int t = 0; t < nTouched && status == 0; t++) status = splitCluster(ev, touched[t]);
+        free(touched);
+        if (status != 0) return -2;
+    }
+    return updateThreshold(ev) == 0 ? 0 : -2;
+}
+
+// Writes the current centroids, as calculateCentroid() builds them, and returns their number
+int incrementalCentroids(const IncrementalEvent *ev, IntersectionPoint *centroids, int maxCentroids){
+    int n = 0;
+    for (int c = 0; c < ev->clusterSlots && n < maxCentroids; c++){
+        const IncCluster *cl = &ev->clusters[c];
+        if (cl->nMembers == 0) continue;
+        IntersectionPoint *out = &centroids[n];
+        out->x = cl->sumX / cl->nMembers;
+        out->y = cl->sumY / cl->nMembers;
+        out->flag = (cl->bitCount[0] > 0) | (cl->bitCount[1] > 0) << 1 | (cl->bitCount[2] > 0) << 2;
+        out->intersects = out->flag == 7;
+        out->num = n++;
+    }
+    return n;
+}
+
+int incrementalHitCount(const IncrementalEvent *ev){
+    return ev->nHits;
+}
+
+int incrementalInterCount(const IncrementalEvent *ev){
+    return ev->nPoints;
+}
+
+int incrementalClusterCount(const IncrementalEvent *ev){
+    return ev->nClusters;
+}
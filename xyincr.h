@@ -0,0 +1,27 @@
+#ifndef XYINCR_H
+#define XYINCR_H
+
+#include "xypicmic.h"
+
+// Stateful reconstruction for the online trigger: hits are added and removed one at a
+// time. A new strip is only intersected with the strips of the other colors already
+// present, and only the clusters its intersections touch are updated.
+//
+// The greedy seed scan of fillCentroids() depends on the order of the whole intersection
+// list and cannot be updated locally, so clusters here are the connected components of
+// the intersections under distance < threshold (single linkage). Every greedy cluster is
+// contained in one of them.
+
+typedef struct IncrementalEvent IncrementalEvent;
+
+IncrementalEvent *createIncrementalEvent(int threshold);
+void freeIncrementalEvent(IncrementalEvent *ev);
+void resetIncrementalEvent(IncrementalEvent *ev);
+int addHit(IncrementalEvent *ev, int row, int col);
+int removeHit(IncrementalEvent *ev, int row, int col);
+int incrementalCentroids(const IncrementalEvent *ev, IntersectionPoint *centroids, int maxCentroids);
+int incrementalHitCount(const IncrementalEvent *ev);
+int incrementalInterCount(const IncrementalEvent *ev);
+int incrementalClusterCount(const IncrementalEvent *ev);
+
+#endif /* XYINCR_H */
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include "xyindex.h"
+#include "xydispatch.h"
+
+FILE *createIndexFile(const char *path){
+    uint32_t version = INDEX_VERSION;
+    FILE *f = fopen(path, "wb");
+    if (f == NULL){
+        perror(path);
+        return NULL;
+    }
+    if (fwrite(INDEX_MAGIC, 1, 4, f) != 4 || fwrite(&version, sizeof(version), 1, f) != 1){
+        perror(path);
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+int writeIndexEntry(FILE *index, const IndexEntry *entry){
+    return fwrite(entry, sizeof(IndexEntry), 1, index) == 1 ? 0 : -1;
+}
+
+void fillIndexEntry(IndexEntry *entry, const PixelHit *hits, int nHits){
+    int n[3];
+    countHitColors(hits, nHits, n);
+    memset(entry, 0, sizeof(IndexEntry));
+    entry->output = -1;
+    entry->inBlock = -1;
+    entry->interCount = -1;
+    entry->centroids3 = -1;
+    for (int c = 0; c < 3; c++) entry->hits[c] = (uint16_t)n[c];
+}
+
+EventIndex *loadEventIndex(const char *path){
+    char magic[4];
+    uint32_t version;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL){
+        perror(path);
+        return NULL;
+    }
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, INDEX_MAGIC, 4) != 0 ||
+        fread(&version, sizeof(version), 1, f) != 1 || version != INDEX_VERSION){
+        fprintf(stderr, "%s: not an event index (version %d)\n", path, INDEX_VERSION);
+        fclose(f);
+        return NULL;
+    }
+    long start = ftell(f);
+    fseek(f, 0, SEEK_END);
+    long n = (ftell(f) - start) / (long)sizeof(IndexEntry);
+    fseek(f, start, SEEK_SET);
+    EventIndex *index = (EventIndex *)calloc(1, sizeof(EventIndex));
+    if (index != NULL) index->entries = (IndexEntry *)malloc((n > 0 ? n : 1) * sizeof(IndexEntry));
+    if (index == NULL || index->entries == NULL){
+        fprintf(stderr, "Cannot allocate the index of %s\n", path);
+        freeEventIndex(index);
+        fclose(f);
+        return NULL;
+    }
+    index->nEvents = (long)fread(index->entries, sizeof(IndexEntry), n, f);
+    if (index->nEvents != n) fprintf(stderr, "%s: truncated after %ld events\n", path, index->nEvents);
+    fclose(f);
+    return index;
+}
+
+void freeEventIndex(EventIndex *index){
+    if (index == NULL) return;
+    free(index->entries);
+    free(index);
+}
+
+void defaultIndexQuery(IndexQuery *query){
+    memset(query, 0, sizeof(IndexQuery));
+    query->last = -1;
+    query->maxHits = -1;
+}
+
+long selectEvents(const EventIndex *index, const IndexQuery *query, long *events){
+    long n = 0;
+    long last = query->last >= 0 && query->last < index->nEvents ? query->last : index->nEvents - 1;
+    for (long e = query->first > 0 ? query->first : 0; e <= last; e++){
+        const IndexEntry *entry = &index->entries[e];
+        int hits = entry->hits[0] + entry->hits[1] + entry->hits[2];
+        if (hits < query->minHits || (query->maxHits >= 0 && hits > query->maxHits)) continue;
+        if ((query->minInter > 0 && entry->interCount < query->minInter) ||
+            (query->minCentroids3 > 0 && entry->centroids3 < query->minCentroids3)) continue;
+        events[n++] = e;
+    }
+    return n;
+}
+
+long indexEventCost(const IndexEntry *entry){
+    long y = entry->hits[0], r = entry->hits[1], b = entry->hits[2];
+    return y*r + y*b + r*b + y + r + b;
+}
+
+int splitEventIndex(const EventIndex *index, int nJobs, long *bounds){
+    if (nJobs > index->nEvents) nJobs = (int)index->nEvents;
+    if (nJobs < 1) nJobs = 1;
+    double total = 0, sum = 0;
+    for (long e = 0; e < index->nEvents; e++) total += indexEventCost(&index->entries[e]);
+    bounds[0] = 0;
+    long e = 0;
+    for (int k = 1; k < nJobs; k++){
+        // the job ends at the first event taking the running cost past its share, leaving at
+        // least one event to each of the jobs still to come
+        double target = total * k / nJobs;
+        while (e < index->nEvents - (nJobs - k) && (e < bounds[k - 1] + 1 || sum < target))
+            sum += indexEventCost(&index->entries[e++]);
+        bounds[k] = e;
+    }
+    bounds[nJobs] = index->nEvents;
+    return nJobs;
+}
+
+int readIndexedEvent(EventSource *src, const IndexEntry *entry, PixelHit **hits, int *hitCap, int *nHits){
+    if (seekEvent(src, entry->input, entry->inBlock) != 0) return -1;
+    return readEvent(src, hits, hitCap, nHits);
+}
@@ -0,0 +1,57 @@
+#ifndef XYINDEX_H
+#define XYINDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "xybatch.h"
+
+// Event index: a sidecar file with one fixed size entry per event, in event order, to select
+// events and read them back by seek instead of parsing the whole event or result file again.
+// File: INDEX_MAGIC, uint32 version, then IndexEntry records in the host byte order. Written by
+// the batch mode (-X, with the results) or by xyquery.exe -w from an event file alone.
+
+#define INDEX_MAGIC "XYIX"
+#define INDEX_VERSION 1
+
+typedef struct {
+    int64_t input;                      // file offset of the event line, or of its archive block
+    int64_t output;                     // file offset of its first row in the batch output, -1 none
+    int32_t inBlock;                    // place in the archive block, -1 for a text file
+    int32_t interCount;                 // -1 when not reconstructed (xyquery -w) or failed
+    uint16_t hits[3];                   // Y, R and B hits, masked pixels excluded
+    int16_t centroids3;                 // rows in the batch output (3-color centroids), -1 unknown
+} IndexEntry;
+
+typedef struct {
+    IndexEntry *entries;
+    long nEvents;
+} EventIndex;
+
+typedef struct {
+    long first;                         // event range, last -1 to the end
+    long last;
+    int minHits;                        // Y + R + B hits
+    int maxHits;                        // -1 no limit
+    int minInter;                       // events with an unknown count only pass at 0
+    int minCentroids3;
+} IndexQuery;
+
+FILE *createIndexFile(const char *path);            // with the header, NULL on error (reported)
+int writeIndexEntry(FILE *index, const IndexEntry *entry);
+void fillIndexEntry(IndexEntry *entry, const PixelHit *hits, int nHits);    // hits, unknown results
+EventIndex *loadEventIndex(const char *path);
+void freeEventIndex(EventIndex *index);
+
+void defaultIndexQuery(IndexQuery *query);          // every event
+long selectEvents(const EventIndex *index, const IndexQuery *query, long *events);  // room for nEvents
+
+// Work estimate of an event, as the batch scheduler: Y*R + Y*B + R*B strip pairs plus the hits
+long indexEventCost(const IndexEntry *entry);
+// Contiguous event ranges of about the same total cost: job k takes events [bounds[k], bounds[k+1]);
+// nJobs is lowered to the number of events. Returns nJobs.
+int splitEventIndex(const EventIndex *index, int nJobs, long *bounds);
+
+// Event of the entry from the indexed event file, by seek; same returns as readEvent()
+int readIndexedEvent(EventSource *src, const IndexEntry *entry, PixelHit **hits, int *hitCap, int *nHits);
+
+#endif /* XYINDEX_H */
@@ -0,0 +1,356 @@
+// Load generator: events replayed into the reconstruction at a given rate and burst pattern,
+// with throughput, queue depth, drops and latency percentiles at the end.
+//   xyload.exe [-e <event file>] [-k <max tracks>] [-r <events/s>] [-B <events per burst>] [-d <seconds>]
+//              [-q <queue size>] [-t <workers>] [-T <tuning file|->] [-i <report interval s>]
+// -r 0 runs closed loop: a new event enters as soon as there is room in the queue, nothing
+// is dropped and the rate is what the workers sustain. The latency of an event runs from
+// its scheduled arrival, so a late generator is charged to the reconstruction as well.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "xypicmic.h"
+#include "xybatch.h"
+#include "xydispatch.h"
+#include "xysynth.h"
+
+#define MAX_WORKERS 64
+#define SYNTHETIC_EVENTS 4096
+#define HIST_SUB_BITS 7                 // 128 sub-buckets per power of 2: values within 1%
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+// Log-linear latency histogram in ns, as in HdrHistogram
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+    double sum;
+} LatencyHistogram;
+
+static int histIndex(uint64_t v){
+    if (v < HIST_SUB) return (int)v;
+    int e = HIST_SUB_BITS;              // highest bit of v
+    while (v >> (e + 1)) e++;
+    return (e - HIST_SUB_BITS + 1) * HIST_SUB + (int)(v >> (e - HIST_SUB_BITS)) - HIST_SUB;
+}
+
+// Middle of the values counted in bucket i
+static double histValue(int i){
+    int group = i / HIST_SUB, sub = i % HIST_SUB;
+    if (group == 0) return sub;
+    double width = (double)(1ULL << (group - 1));
+    return (HIST_SUB + sub) * width + (width - 1) / 2;
+}
+
+static void recordLatency(LatencyHistogram *h, uint64_t ns){
+    h->counts[histIndex(ns)]++;
+    h->total++;
+    h->sum += ns;
+    if (ns > h->max) h->max = ns;
+}
+
+static double percentile(const LatencyHistogram *h, double p){
+    uint64_t rank = (uint64_t)(p / 100.0 * h->total);
+    if (rank >= h->total) rank = h->total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++){
+        seen += h->counts[i];
+        if (seen > rank) return histValue(i) < h->max ? histValue(i) : (double)h->max;
+    }
+    return (double)h->max;
+}
+
+static void mergeHistogram(LatencyHistogram *into, const LatencyHistogram *from){
+    for (int i = 0; i < HIST_BUCKETS; i++) into->counts[i] += from->counts[i];
+    into->total += from->total;
+    into->sum += from->sum;
+    if (from->max > into->max) into->max = from->max;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static void sleepUntil(double t){
+    struct timespec ts;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+        ;
+}
+
+// ----------------------------------------------------------------
+// events replayed in a loop
+// ----------------------------------------------------------------
+
+typedef struct {
+    PixelHit *hits;
+    int *offset;                        // nEvents + 1
+    int nEvents;
+} EventPool;
+
+static int addPoolEvent(EventPool *pool, const PixelHit *hits, int nHits, int *eventCap, int *hitCap){
+    if (pool->nEvents + 1 >= *eventCap){
+        int cap = *eventCap ? 2 * *eventCap : 1024;
+        int *o = (int *)realloc(pool->offset, cap * sizeof(int));
+        if (o == NULL) return -1;
+        pool->offset = o;
+        *eventCap = cap;
+    }
+    if (pool->nEvents == 0) pool->offset[0] = 0;
+    int used = pool->offset[pool->nEvents];
+    if (used + nHits > *hitCap){
+        int cap = 2*(used + nHits);
+        PixelHit *h = (PixelHit *)realloc(pool->hits, cap * sizeof(PixelHit));
+        if (h == NULL) return -1;
+        pool->hits = h;
+        *hitCap = cap;
+    }
+    memcpy(pool->hits + used, hits, nHits * sizeof(PixelHit));
+    pool->offset[++pool->nEvents] = used + nHits;
+    return 0;
+}
+
+static int loadPool(EventPool *pool, const char *path, int maxTracks){
+    int eventCap = 0, hitCap = 0;
+    memset(pool, 0, sizeof(EventPool));
+    if (path == NULL){
+        SynthRng rng;
+        PixelHit hits[SYNTH_MAX_HITS(64)];
+        seedSynthRng(&rng, 1);
+        for (int e = 0; e < SYNTHETIC_EVENTS; e++){
+            int n = syntheticEvent(&rng, hits, maxTracks);
+            if (n > 0 && addPoolEvent(pool, hits, n, &eventCap, &hitCap) != 0) return -1;
+        }
+        return 0;
+    }
+    FILE *in = fopen(path, "rb");
+    EventSource src;
+    if (in == NULL || openEventSource(&src, in) != 0){
+        if (in == NULL) perror(path);
+        else fclose(in);
+        return -1;
+    }
+    PixelHit *hits = NULL; int cap = 0, nHits = 0, rc;
+    while ((rc = readEvent(&src, &hits, &cap, &nHits)) != 0){
+        if (rc > 0 && addPoolEvent(pool, hits, nHits, &eventCap, &hitCap) != 0){
+            rc = -1;
+            break;
+        }
+    }
+    closeEventSource(&src);
+    fclose(in);
+    free(hits);
+    return rc < 0 || pool->nEvents == 0 ? -1 : 0;
+}
+
+// ----------------------------------------------------------------
+// queue between the generator and the workers
+// ----------------------------------------------------------------
+
+typedef struct {
+    int event;
+    double arrival;                     // scheduled
+} QueueItem;
+
+typedef struct {
+    QueueItem *items;
+    int capacity;
+    int head;
+    int size;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    const EventPool *pool;
+    const DispatchTuning *tuning;
+    long completed;                     // under lock, for the interval reports
+} LoadQueue;
+
+typedef struct {
+    LoadQueue *queue;
+    EventResult res;
+    LatencyHistogram hist;
+    int failed;
+} LoadWorker;
+
+static void *loadWorker(void *arg){
+    LoadWorker *w = (LoadWorker *)arg;
+    LoadQueue *q = w->queue;
+    for (;;){
+        pthread_mutex_lock(&q->lock);
+        while (q->size == 0 && !q->closed) pthread_cond_wait(&q->notEmpty, &q->lock);
+        if (q->size == 0){
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        QueueItem item = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->size--;
+        pthread_cond_signal(&q->notFull);
+        pthread_mutex_unlock(&q->lock);
+
+        const PixelHit *hits = q->pool->hits + q->pool->offset[item.event];
+        int nHits = q->pool->offset[item.event + 1] - q->pool->offset[item.event];
+        if (reconstructDispatched(q->tuning, hits, nHits, selThreshold(nHits), &w->res) != 0) w->failed = 1;
+        double latency = now() - item.arrival;
+        recordLatency(&w->hist, latency > 0 ? (uint64_t)(latency * 1e9) : 0);
+
+        pthread_mutex_lock(&q->lock);
+        q->completed++;
+        pthread_mutex_unlock(&q->lock);
+    }
+    return NULL;
+}
+
+static void usage(const char *prog){
+    printf("Usage: %s [-e <event file>] [-k <max tracks>] [-r <events/s>] [-B <events per burst>] [-d <seconds>]\n", prog);
+    printf("          [-q <queue size>] [-t <workers>] [-T <tuning file|->] [-i <report interval s>]\n");
+}
+
+int main(int argc, char *argv[]){
+    const char *eventFile = NULL, *tuningFile = NULL;
+    int maxTracks = 8, burst = 1, queueSize = 1024, nWorkers = 1;
+    double rate = 10000, duration = 10, interval = 1;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) eventFile = argv[++i];
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) maxTracks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) burst = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) duration = atof(argv[++i]);
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) queueSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) nWorkers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) tuningFile = argv[++i];
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) interval = atof(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (maxTracks < 1 || maxTracks > 64) maxTracks = maxTracks < 1 ? 1 : 64;
+    if (burst < 1) burst = 1;
+    if (queueSize < 1) queueSize = 1;
+    if (nWorkers < 1) nWorkers = 1;
+    if (nWorkers > MAX_WORKERS) nWorkers = MAX_WORKERS;
+
+    initStripPixelTable();
+    EventPool pool;
+    if (loadPool(&pool, eventFile, maxTracks) != 0){
+        fprintf(stderr, "No events to replay\n");
+        return 1;
+    }
+    DispatchTuning tuning;
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (initDispatchTuning(&tuning, tuningFile, cpus > nWorkers ? cpus / nWorkers : 1) != 0) return 1;
+    if (tuningFile != NULL) printDispatchTuning(&tuning, stderr);
+
+    LoadQueue q;
+    memset(&q, 0, sizeof(q));
+    q.items = (QueueItem *)malloc(queueSize * sizeof(QueueItem));
+    q.capacity = queueSize;
+    q.pool = &pool;
+    q.tuning = &tuning;
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_cond_init(&q.notEmpty, NULL);
+    pthread_cond_init(&q.notFull, NULL);
+    LoadWorker *workers = (LoadWorker *)calloc(nWorkers, sizeof(LoadWorker));
+    pthread_t tids[MAX_WORKERS];
+    if (q.items == NULL || workers == NULL){
+        fprintf(stderr, "Cannot allocate the workers\n");
+        return 1;
+    }
+    int started = 0;
+    for (int t = 0; t < nWorkers; t++){
+        workers[t].queue = &q;
+        initEventResult(&workers[t].res);
+        if (pthread_create(&tids[t], NULL, loadWorker, &workers[t]) != 0) break;
+        started++;
+    }
+    if (started == 0){
+        fprintf(stderr, "Cannot start the workers\n");
+        return 1;
+    }
+
+    long offered = 0, dropped = 0, depthSamples = 0, intervalOffered = 0, intervalDropped = 0;
+    long lastCompleted = 0;
+    double depthSum = 0;
+    int depthMax = 0;
+    double start = now(), end = start + duration, nextReport = start + interval;
+    for (long b = 0; ; b++){
+        double arrival = rate > 0 ? start + b * burst / rate : now();
+        if (arrival >= end || (rate > 0 && now() >= end)) break;      // also when the generator itself falls behind
+        if (rate > 0) sleepUntil(arrival);
+
+        pthread_mutex_lock(&q.lock);
+        for (int k = 0; k < burst; k++){
+            while (rate <= 0 && q.size == q.capacity) pthread_cond_wait(&q.notFull, &q.lock);
+            depthSum += q.size;
+            depthSamples++;
+            if (q.size > depthMax) depthMax = q.size;
+            offered++;
+            intervalOffered++;
+            if (q.size == q.capacity){
+                dropped++;
+                intervalDropped++;
+                continue;
+            }
+            QueueItem *item = &q.items[(q.head + q.size) % q.capacity];
+            item->event = (int)(offered % pool.nEvents);
+            item->arrival = rate > 0 ? arrival : now();
+            q.size++;
+        }
+        pthread_cond_broadcast(&q.notEmpty);
+        int depth = q.size;
+        long completed = q.completed;
+        pthread_mutex_unlock(&q.lock);
+
+        double t = now();
+        if (interval > 0 && t >= nextReport){
+            fprintf(stderr, "t=%.1fs offered=%ld completed=%ld dropped=%ld queue=%d\n", t - start,
+                    intervalOffered, completed - lastCompleted, intervalDropped, depth);
+            intervalOffered = intervalDropped = 0;
+            lastCompleted = completed;
+            nextReport += interval;
+        }
+    }
+    double offeredSeconds = now() - start;
+
+    pthread_mutex_lock(&q.lock);
+    q.closed = 1;
+    pthread_cond_broadcast(&q.notEmpty);
+    pthread_mutex_unlock(&q.lock);
+    int failed = 0;
+    static LatencyHistogram hist;
+    for (int t = 0; t < started; t++){
+        pthread_join(tids[t], NULL);
+        mergeHistogram(&hist, &workers[t].hist);
+        failed |= workers[t].failed;
+        freeEventResult(&workers[t].res);
+    }
+    double seconds = now() - start;
+
+    printf("offered %ld events in %.2f s (%.0f/s), completed %llu in %.2f s (%.0f/s), dropped %ld (%.2f%%)\n",
+           offered, offeredSeconds, offered / offeredSeconds, (unsigned long long)hist.total, seconds,
+           hist.total / seconds, dropped, offered ? 100.0 * dropped / offered : 0.0);
+    printf("queue depth at arrival: mean %.1f, max %d of %d\n", depthSamples ? depthSum / depthSamples : 0.0, depthMax, queueSize);
+    if (hist.total > 0){
+        printf("latency us: mean %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f p99.99 %.1f max %.1f\n",
+               hist.sum / hist.total * 1e-3, percentile(&hist, 50) * 1e-3, percentile(&hist, 90) * 1e-3,
+               percentile(&hist, 99) * 1e-3, percentile(&hist, 99.9) * 1e-3, percentile(&hist, 99.99) * 1e-3,
+               hist.max * 1e-3);
+    }
+
+    free(q.items);
+    free(workers);
+    free(pool.hits);
+    free(pool.offset);
+    if (failed) fprintf(stderr, "Out of memory in a reconstruction\n");
+    return failed;
+}
@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "xylut.h"
+
+#define HEADER_SIZE 16
+#define XY_BYTES ((size_t)3 * LUT_PAIRS * 2 * sizeof(float))
+#define ACCEPT_BYTES ((size_t)3 * LUT_WORDS * sizeof(uint32_t))
+#define FILE_SIZE (HEADER_SIZE + XY_BYTES + ACCEPT_BYTES)
+
+static const char pairColors[3][3] = {{'Y', 'R', 2}, {'Y', 'B', 1}, {'R', 'B', 0}};     // and the third color
+
+static void setPointers(IntersectionLUT *lut, unsigned char *tables){
+    lut->xy = (const float (*)[2])tables;
+    lut->accept = (const uint32_t *)(tables + XY_BYTES);
+}
+
+// Fills the tables of one layout: float xy[3 * LUT_PAIRS][2], then uint32 accept[3 * LUT_WORDS]
+static void fillTables(unsigned char *tables){
+    float (*xy)[2] = (float (*)[2])tables;
+    uint32_t *accept = (uint32_t *)(tables + XY_BYTES);
+    memset(accept, 0, ACCEPT_BYTES);
+    initStripPixelTable();
+    for (int t = 0; t < 3; t++){
+        int first = assign_number(pairColors[t][0]), second = assign_number(pairColors[t][1]), third = pairColors[t][2];
+        for (int a = 0; a < STRIP_SLOTS; a++){
+            LineCoordinates la = calculateLineCoordinates(pairColors[t][0], a);
+            for (int b = 0; b < STRIP_SLOTS; b++){
+                LineCoordinates lb = calculateLineCoordinates(pairColors[t][1], b);
+                IntersectionPoint p = calculateIntersection(la, lb);
+                size_t k = (size_t)t * LUT_PAIRS + (size_t)a * STRIP_SLOTS + b;
+                xy[k][0] = (float)p.x;
+                xy[k][1] = (float)p.y;
+                double u[3];
+                stripCoordinates(p.x, p.y, u);
+                long s = lround(u[third]);
+                if (stripPixel[first][a] >= 0 && stripPixel[second][b] >= 0 && s >= 0 && s < STRIP_SLOTS
+                    && stripPixel[third][s] >= 0){
+                    size_t bit = (size_t)t * LUT_WORDS * 32 + (size_t)a * STRIP_SLOTS + b;
+                    accept[bit >> 5] |= 1u << (bit & 31);
+                }
+            }
+        }
+    }
+}
+
+IntersectionLUT *buildIntersectionLUT(void){
+    IntersectionLUT *lut = (IntersectionLUT *)calloc(1, sizeof(IntersectionLUT));
+    if (lut != NULL) lut->data = malloc(XY_BYTES + ACCEPT_BYTES);
+    if (lut == NULL || lut->data == NULL){
+        fprintf(stderr, "Cannot allocate the intersection tables\n");
+        free(lut);
+        return NULL;
+    }
+    lut->size = XY_BYTES + ACCEPT_BYTES;
+    fillTables((unsigned char *)lut->data);
+    setPointers(lut, (unsigned char *)lut->data);
+    return lut;
+}
+
+static void fillHeader(unsigned char *header){
+    uint32_t fields[3] = {LUT_VERSION, STRIP_SLOTS, 0};
+    memcpy(header, LUT_MAGIC, 4);
+    memcpy(header + 4, fields, sizeof(fields));
+}
+
+// Written to a temporary file renamed into place, so that a concurrent reader never maps half a table
+static int saveIntersectionLUT(const IntersectionLUT *lut, const char *path){
+    unsigned char header[HEADER_SIZE];
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+    fillHeader(header);
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL){
+        perror(tmp);
+        return -1;
+    }
+    int ok = fwrite(header, 1, HEADER_SIZE, f) == HEADER_SIZE && fwrite(lut->data, 1, lut->size, f) == lut->size;
+    if (fclose(f) != 0 || !ok || rename(tmp, path) != 0){
+        perror(path);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// The mapped cache, NULL when it is missing or was written with another layout
+static IntersectionLUT *mapIntersectionLUT(const char *path){
+    unsigned char header[HEADER_SIZE];
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    fillHeader(header);
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == FILE_SIZE)
+        p = mmap(NULL, FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    IntersectionLUT *lut = memcmp(p, header, HEADER_SIZE) == 0 ? (IntersectionLUT *)calloc(1, sizeof(IntersectionLUT)) : NULL;
+    if (lut == NULL){
+        munmap(p, FILE_SIZE);
+        return NULL;
+    }
+    lut->data = p;
+    lut->size = FILE_SIZE;
+    lut->mapped = 1;
+    setPointers(lut, (unsigned char *)p + HEADER_SIZE);
+    return lut;
+}
+
+IntersectionLUT *loadIntersectionLUT(const char *path){
+    if (strcmp(path, "-") == 0) return buildIntersectionLUT();
+    IntersectionLUT *lut = mapIntersectionLUT(path);
+    if (lut != NULL) return lut;
+    if ((lut = buildIntersectionLUT()) == NULL) return NULL;
+    if (saveIntersectionLUT(lut, path) == 0) fprintf(stderr, "Intersection tables written to %s\n", path);
+    return lut;
+}
+
+void freeIntersectionLUT(IntersectionLUT *lut){
+    if (lut == NULL) return;
+    if (lut->mapped) munmap(lut->data, lut->size);
+    else free(lut->data);
+    free(lut);
+}
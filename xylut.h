@@ -0,0 +1,53 @@
+#ifndef XYLUT_H
+#define XYLUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "xypicmic.h"
+
+// Precomputed crossings of every Y-R, Y-B and R-B strip pair (3 x 854 x 854), as float x, y,
+// plus one bit per pair set when the crossing lies on a read-out strip of the third color
+// (inside the sensor). When intersectionLUT is set, xLines() and the grid and parallel paths
+// look the crossings up instead of calling calculateIntersection(): same flag and intersects,
+// coordinates rounded to float (within 0.001 um of the analytic ones over the sensor).
+// resolveEvent() tests the acceptance bits of the Y-R pairs under half a strip of tolerance.
+// Cache file: LUT_MAGIC, uint32 version, uint32 STRIP_SLOTS, uint32 0, then the xy tables and
+// the acceptance bits, in the host byte order, mapped read only by loadIntersectionLUT().
+
+#define LUT_MAGIC "XYLT"
+#define LUT_VERSION 1
+#define LUT_PAIRS (STRIP_SLOTS * STRIP_SLOTS)
+#define LUT_WORDS ((LUT_PAIRS + 31) / 32)
+
+enum { LUT_YR, LUT_YB, LUT_RB };        // table of a pair: first strip Y, Y, R
+
+typedef struct {
+    const float (*xy)[2];               // [3 * LUT_PAIRS], pair (a, b) of table t at t*LUT_PAIRS + a*STRIP_SLOTS + b
+    const uint32_t *accept;             // [3 * LUT_WORDS]
+    void *data;                         // mapping or allocation behind xy and accept
+    size_t size;
+    int mapped;
+} IntersectionLUT;
+
+extern const IntersectionLUT *intersectionLUT;     // NULL: analytic crossings (default)
+
+IntersectionLUT *buildIntersectionLUT(void);
+// Maps the cache file, or builds the tables and writes them there when it is missing or stale.
+// "-" builds in memory only. Returns NULL on error (reported).
+IntersectionLUT *loadIntersectionLUT(const char *path);
+void freeIntersectionLUT(IntersectionLUT *lut);
+
+static inline int lutAccepted(const IntersectionLUT *lut, int table, int a, int b){
+    size_t k = (size_t)table * LUT_WORDS * 32 + (size_t)a * STRIP_SLOTS + b;
+    return (lut->accept[k >> 5] >> (k & 31)) & 1;
+}
+
+// Same result as calculateIntersection(*first, *second) for lines of the table's colors, in that order
+static inline IntersectionPoint lutIntersection(const IntersectionLUT *lut, int table, unsigned long flag,
+                                                const LineCoordinates *first, const LineCoordinates *second){
+    const float *p = lut->xy[(size_t)table * LUT_PAIRS + first->val * STRIP_SLOTS + second->val];
+    IntersectionPoint result = {p[0], p[1], true, flag, 0};
+    return result;
+}
+
+#endif /* XYLUT_H */
@@ -0,0 +1,145 @@
+#include "xymask.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct OccupancyTracker {
+    int blockEvents;                    // events per block
+    int current;                        // block being filled
+    int eventsInBlock[MASK_BLOCKS];
+    int eventsInWindow;
+    double maxRate;
+    unsigned long totalEvents;
+    int newlyMasked;
+    short stripOfPixel[NUM_PIXELS];     // color*STRIP_SLOTS+value, -1 for dummy cells
+    unsigned int pixelBlock[MASK_BLOCKS][NUM_PIXELS];
+    unsigned int stripBlock[MASK_BLOCKS][3*STRIP_SLOTS];
+    unsigned int pixelCount[NUM_PIXELS];        // sums over the window
+    unsigned int stripCount[3*STRIP_SLOTS];
+};
+
+static void setPixelMask(int pixel){
+    hotPixelMask[pixel >> 3] |= (unsigned char)(1u << (pixel & 7));
+}
+
+OccupancyTracker *createOccupancyTracker(int windowEvents, double maxRate){
+    OccupancyTracker *t = (OccupancyTracker *)calloc(1, sizeof(OccupancyTracker));
+    if (t == NULL) return NULL;
+    t->blockEvents = windowEvents / MASK_BLOCKS > 0 ? windowEvents / MASK_BLOCKS : 1;
+    t->maxRate = maxRate;
+    for (int row = 0; row < ROWS; row++){
+        for (int col = 0; col < COLS; col++){
+            const char *name = arr[row][col];
+            int color = assign_number(name[0]);
+            t->stripOfPixel[row*COLS+col] = color < 0 ? -1 : (short)(color*STRIP_SLOTS + atoi(&name[1]));
+        }
+    }
+    return t;
+}
+
+void freeOccupancyTracker(OccupancyTracker *tracker){
+    free(tracker);
+}
+
+// Masks the pixels of the window above maxRate, returns how many were added
+static int updateMask(OccupancyTracker *t){
+    int added = 0;
+    unsigned int limit = (unsigned int)(t->maxRate * t->eventsInWindow);
+    for (int p = 0; p < NUM_PIXELS; p++){
+        if (t->pixelCount[p] > limit && !PIXEL_MASKED(p / COLS, p % COLS)){
+            setPixelMask(p);
+            added++;
+        }
+    }
+    return added;
+}
+
+// Accounts the raw hits of one event (masked pixels included, so that their rate stays
+// known) and returns the number of pixels masked at this event.
+int trackOccupancy(OccupancyTracker *t, const PixelHit *hits, int nHits){
+    int b = t->current;
+    for (int i = 0; i < nHits; i++){
+        if (hits[i].row < 0 || hits[i].row >= ROWS || hits[i].col < 0 || hits[i].col >= COLS) continue;
+        int p = hits[i].row*COLS + hits[i].col;
+        t->pixelBlock[b][p]++;
+        t->pixelCount[p]++;
+        int s = t->stripOfPixel[p];
+        if (s >= 0){
+            t->stripBlock[b][s]++;
+            t->stripCount[s]++;
+        }
+    }
+    t->eventsInBlock[b]++;
+    t->eventsInWindow++;
+    t->totalEvents++;
+    if (t->eventsInBlock[b] < t->blockEvents) return 0;
+
+    // block complete: evaluate, then recycle the oldest block for the next events
+    int added = updateMask(t);
+    t->newlyMasked += added;
+    int next = (b + 1) % MASK_BLOCKS;
+    if (t->eventsInBlock[next] > 0){
+        for (int p = 0; p < NUM_PIXELS; p++) t->pixelCount[p] -= t->pixelBlock[next][p];
+        for (int s = 0; s < 3*STRIP_SLOTS; s++) t->stripCount[s] -= t->stripBlock[next][s];
+        memset(t->pixelBlock[next], 0, sizeof(t->pixelBlock[next]));
+        memset(t->stripBlock[next], 0, sizeof(t->stripBlock[next]));
+        t->eventsInWindow -= t->eventsInBlock[next];
+        t->eventsInBlock[next] = 0;
+    }
+    t->current = next;
+    return added;
+}
+
+void printOccupancySummary(const OccupancyTracker *t, FILE *out){
+    static const char colors[3] = {'Y', 'R', 'B'};
+    int busiest = 0;
+    for (int s = 1; s < 3*STRIP_SLOTS; s++){
+        if (t->stripCount[s] > t->stripCount[busiest]) busiest = s;
+    }
+    fprintf(out, "mask: events=%lu window=%d masked=%d (auto %d) busiestStrip=%c%d rate=%.4f\n",
+            t->totalEvents, t->eventsInWindow, countMaskedPixels(), t->newlyMasked,
+            colors[busiest / STRIP_SLOTS], busiest % STRIP_SLOTS,
+            t->eventsInWindow ? (double)t->stripCount[busiest] / t->eventsInWindow : 0.0);
+}
+
+int countMaskedPixels(void){
+    int n = 0;
+    for (int p = 0; p < NUM_PIXELS; p++){
+        if (PIXEL_MASKED(p / COLS, p % COLS)) n++;
+    }
+    return n;
+}
+
+// Mask file: one "row col" pair per line, text after the pair and '#' lines are ignored.
+// A missing file is not an error (first run), returns -1 only for unreadable content.
+int loadPixelMask(const char *path){
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return 0;
+    char line[MAX_LINE_LENGTH];
+    int status = 0;
+    while (fgets(line, sizeof(line), f) != NULL){
+        int row, col;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%d %d", &row, &col) != 2 || row < 0 || row >= ROWS || col < 0 || col >= COLS){
+            fprintf(stderr, "Invalid line in mask file %s: %s", path, line);
+            status = -1;
+            continue;
+        }
+        setPixelMask(row*COLS + col);
+    }
+    fclose(f);
+    return status;
+}
+
+int savePixelMask(const char *path){
+    FILE *f = fopen(path, "w");
+    if (f == NULL){
+        perror("Error opening mask file");
+        return -1;
+    }
+    fprintf(f, "# row col strip\n");
+    for (int p = 0; p < NUM_PIXELS; p++){
+        if (PIXEL_MASKED(p / COLS, p % COLS)) fprintf(f, "%d %d %s\n", p / COLS, p % COLS, arr[p / COLS][p % COLS]);
+    }
+    fclose(f);
+    return 0;
+}
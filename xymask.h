@@ -0,0 +1,24 @@
+#ifndef XYMASK_H
+#define XYMASK_H
+
+#include <stdio.h>
+#include "xypicmic.h"
+
+// Streaming occupancy of pixels and strips over a sliding window of events. Pixels
+// firing in more than maxRate of the events of the window are set in hotPixelMask.
+// Masks are sticky for the rest of the run; the window is kept as MASK_BLOCKS blocks so
+// that the oldest block can be dropped without storing the events themselves.
+
+#define MASK_BLOCKS 8
+
+typedef struct OccupancyTracker OccupancyTracker;
+
+OccupancyTracker *createOccupancyTracker(int windowEvents, double maxRate);
+void freeOccupancyTracker(OccupancyTracker *tracker);
+int trackOccupancy(OccupancyTracker *tracker, const PixelHit *hits, int nHits);
+void printOccupancySummary(const OccupancyTracker *tracker, FILE *out);
+int countMaskedPixels(void);
+int loadPixelMask(const char *path);
+int savePixelMask(const char *path);
+
+#endif /* XYMASK_H */
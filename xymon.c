@@ -0,0 +1,128 @@
+// Live monitor: reads the shared memory feed of a running xypicmic.exe -P <name> (xymonitor.h)
+// without slowing it down.
+//   xymon.exe <name> [-i <seconds>] [-n <reports>]    run counters and rates every interval
+//   xymon.exe <name> -e [-n <events>]                 follows the events, centroid csv rows
+// -u removes the segment once the writer is gone.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "xymonitor.h"
+#include "xyformat.h"
+
+static void sleepSeconds(double s){
+    struct timespec ts;
+    ts.tv_sec = (time_t)s;
+    ts.tv_nsec = (long)((s - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+// Same rows as the batch output, for the 3-color centroids kept in the feed
+static void putEvent(TextBuffer *tb, const MonitorEvent *ev){
+    for (int k = 0; k < ev->kept; k++){
+        const MonitorCentroid *c = &ev->centroids[k];
+        if (c->flag != 7 || c->num < 0) break;
+        putInt(tb, ev->event);
+        putChar(tb, ';');
+        putInt(tb, c->num);
+        putChar(tb, ';');
+        putInt(tb, c->flag);
+        putChar(tb, ';');
+        putInt(tb, c->intersects);
+        putChar(tb, ';');
+        putFixed(tb, c->x, 4);
+        putChar(tb, ';');
+        putFixed(tb, c->y, 4);
+        putChar(tb, '\n');
+    }
+}
+
+static int followEvents(Monitor *mon, long maxEvents){
+    TextBuffer text;
+    MonitorEvent ev;
+    long shown = 0, lost = 0;
+    uint64_t next = monitorHead(mon);
+    initTextBuffer(&text, stdout, 1 << 16);
+    putText(&text, "event;numCluster;centroidFlag; centroid3Colors;x;y\n");
+    while (maxEvents <= 0 || shown < maxEvents){
+        uint64_t head = monitorHead(mon);
+        if (head < next) next = 0;                      // the writer restarted
+        if (head - next > MONITOR_SLOTS){
+            lost += (long)(head - next - MONITOR_SLOTS);
+            next = head - MONITOR_SLOTS;
+        }
+        if (next == head){
+            flushTextBuffer(&text);
+            fflush(stdout);
+            sleepSeconds(0.01);
+            continue;
+        }
+        for (; next < head && (maxEvents <= 0 || shown < maxEvents); next++){
+            if (readMonitorEvent(mon, next, &ev) != 0){
+                lost++;
+                continue;
+            }
+            putEvent(&text, &ev);
+            shown++;
+        }
+    }
+    freeTextBuffer(&text);
+    if (lost > 0) fprintf(stderr, "%ld events overwritten before they were read\n", lost);
+    return 0;
+}
+
+static int reportCounters(Monitor *mon, double interval, long reports){
+    MonitorCounters prev, now;
+    readMonitorCounters(mon, &prev);
+    printf("time;events;failed;degraded;skipped;rate;hitsPerEvent;intersectionsPerEvent;centroidsPerEvent;centroids3PerEvent;idle\n");
+    for (long r = 0; reports <= 0 || r < reports; r++){
+        sleepSeconds(interval);
+        readMonitorCounters(mon, &now);
+        if (now.startTime != prev.startTime) prev = now;        // the writer restarted
+        double dt = (now.updateTime - prev.updateTime) * 1e-9;
+        double n = now.events > 0 ? (double)now.events : 1;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        double idle = ts.tv_sec + 1e-9*ts.tv_nsec - now.updateTime * 1e-9;
+        printf("%.1f;%llu;%llu;%llu;%llu;%.0f;%.2f;%.2f;%.3f;%.3f;%.1f\n", (now.updateTime - now.startTime) * 1e-9,
+               (unsigned long long)now.events, (unsigned long long)now.failed, (unsigned long long)now.degraded,
+               (unsigned long long)now.skipped,
+               dt > 0 ? (now.events - prev.events) / dt : 0.0, now.hits / n, now.intersections / n,
+               now.centroids / n, now.centroids3 / n, idle);
+        fflush(stdout);
+        prev = now;
+    }
+    return 0;
+}
+
+static void usage(const char *prog){
+    printf("Usage: %s <name> [-i <seconds>] [-n <reports>]\n", prog);
+    printf("       %s <name> -e [-n <events>]\n", prog);
+    printf("       %s <name> -u\n", prog);
+}
+
+int main(int argc, char *argv[]){
+    double interval = 1;
+    long count = 0;
+    int events = 0;
+    if (argc < 2 || argv[1][0] == '-'){
+        usage(argv[0]);
+        return 1;
+    }
+    for (int i = 2; i < argc; i++){
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) interval = atof(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) count = atol(argv[++i]);
+        else if (strcmp(argv[i], "-e") == 0) events = 1;
+        else if (strcmp(argv[i], "-u") == 0) return removeMonitor(argv[1]) == 0 ? 0 : 1;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    Monitor *mon = openMonitor(argv[1]);
+    if (mon == NULL) return 1;
+    int status = events ? followEvents(mon, count) : reportCounters(mon, interval > 0 ? interval : 1, count);
+    closeMonitor(mon);
+    return status;
+}
@@ -0,0 +1,220 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "xymonitor.h"
+
+#define READ_RETRIES 1000               // a writer killed inside a write leaves its sequence odd
+
+typedef struct {
+    uint32_t seq;
+    uint32_t reserved;
+    MonitorEvent ev;
+} MonitorSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t maxCentroids;
+    uint64_t head;
+    uint32_t counterSeq;
+    uint32_t reserved;
+    MonitorCounters counters;
+    MonitorSlot slot[MONITOR_SLOTS];
+} MonitorSegment;
+
+struct Monitor {
+    MonitorSegment *seg;
+    int writer;
+    pthread_mutex_t lock;               // between the writer threads of this process only
+    MonitorCounters counters;           // writer copy, published after every event
+};
+
+static void segmentName(const char *name, char *out, size_t size){
+    snprintf(out, size, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+static int64_t realtimeNs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+Monitor *createMonitor(const char *name){
+    char path[256];
+    segmentName(name, path, sizeof(path));
+    int fd = shm_open(path, O_CREAT | O_RDWR, 0644);
+    if (fd < 0){
+        perror(path);
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(MonitorSegment)) != 0){
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, sizeof(MonitorSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    Monitor *mon = (Monitor *)calloc(1, sizeof(Monitor));
+    if (p == MAP_FAILED || mon == NULL){
+        fprintf(stderr, "Cannot map the monitoring segment %s\n", path);
+        if (p != MAP_FAILED) munmap(p, sizeof(MonitorSegment));
+        free(mon);
+        return NULL;
+    }
+    mon->seg = (MonitorSegment *)p;
+    mon->writer = 1;
+    pthread_mutex_init(&mon->lock, NULL);
+
+    // a new run: readers see the magic again once the segment is reset
+    __atomic_store_n(&mon->seg->magic, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(&mon->seg->head, 0, sizeof(MonitorSegment) - offsetof(MonitorSegment, head));
+    mon->seg->version = MONITOR_VERSION;
+    mon->seg->slots = MONITOR_SLOTS;
+    mon->seg->maxCentroids = MONITOR_MAX_CENTROIDS;
+    mon->counters.startTime = mon->counters.updateTime = realtimeNs();
+    mon->seg->counters = mon->counters;
+    __atomic_store_n(&mon->seg->magic, MONITOR_MAGIC, __ATOMIC_RELEASE);
+    return mon;
+}
+
+// Event `event` (-1: its position in the feed) with nCentroids centroids, -1 if it failed
+void publishMonitorEvent(Monitor *mon, int64_t event, int nHits, int interCount,
+                         const IntersectionPoint *centroids, int nCentroids, int budget){
+    MonitorSegment *seg = mon->seg;
+    pthread_mutex_lock(&mon->lock);
+    uint64_t index = seg->head;
+    MonitorSlot *slot = &seg->slot[index % MONITOR_SLOTS];
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    MonitorEvent *ev = &slot->ev;
+    ev->index = index;
+    ev->event = event >= 0 ? event : (int64_t)index;
+    ev->nHits = nHits;
+    ev->interCount = interCount;
+    ev->nCentroids = nCentroids;
+    int kept = 0, n3 = 0;
+    for (int pass = 0; pass < 2; pass++){           // 3-color centroids first
+        for (int k = 0; k < nCentroids && kept < MONITOR_MAX_CENTROIDS; k++){
+            if ((centroids[k].flag == 7 && centroids[k].num > -1) != (pass == 0)) continue;
+            ev->centroids[kept].x = centroids[k].x;
+            ev->centroids[kept].y = centroids[k].y;
+            ev->centroids[kept].flag = centroids[k].flag;
+            ev->centroids[kept].num = centroids[k].num;
+            ev->centroids[kept].intersects = centroids[k].intersects;
+            ev->centroids[kept++].reserved = 0;
+        }
+    }
+    ev->kept = kept;
+    ev->budget = budget;
+    ev->reserved = 0;
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&seg->head, index + 1, __ATOMIC_RELEASE);
+
+    MonitorCounters *c = &mon->counters;
+    c->events++;
+    if (nCentroids < 0) c->failed++;
+    if (budget == BUDGET_DEGRADED) c->degraded++;
+    if (budget == BUDGET_SKIPPED) c->skipped++;
+    c->hits += nHits;
+    if (interCount > 0) c->intersections += interCount;
+    for (int k = 0; k < nCentroids; k++){
+        c->centroids++;
+        if (centroids[k].flag == 7 && centroids[k].num > -1) n3++;
+    }
+    c->centroids3 += n3;
+    c->updateTime = realtimeNs();
+    seq = seg->counterSeq;
+    __atomic_store_n(&seg->counterSeq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    seg->counters = *c;
+    __atomic_store_n(&seg->counterSeq, seq + 2, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&mon->lock);
+}
+
+void closeMonitor(Monitor *mon){
+    if (mon == NULL) return;
+    if (mon->writer) pthread_mutex_destroy(&mon->lock);
+    munmap(mon->seg, sizeof(MonitorSegment));
+    free(mon);
+}
+
+int removeMonitor(const char *name){
+    char path[256];
+    segmentName(name, path, sizeof(path));
+    return shm_unlink(path);
+}
+
+Monitor *openMonitor(const char *name){
+    char path[256];
+    struct stat st;
+    segmentName(name, path, sizeof(path));
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0){
+        perror(path);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MonitorSegment)){
+        fprintf(stderr, "%s is not a monitoring segment\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, sizeof(MonitorSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED){
+        perror(path);
+        return NULL;
+    }
+    MonitorSegment *seg = (MonitorSegment *)p;
+    if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != MONITOR_MAGIC || seg->version != MONITOR_VERSION){
+        fprintf(stderr, "%s: no writer yet or another version\n", path);
+        munmap(p, sizeof(MonitorSegment));
+        return NULL;
+    }
+    Monitor *mon = (Monitor *)calloc(1, sizeof(Monitor));
+    if (mon == NULL){
+        munmap(p, sizeof(MonitorSegment));
+        return NULL;
+    }
+    mon->seg = seg;
+    return mon;
+}
+
+uint64_t monitorHead(const Monitor *mon){
+    return __atomic_load_n(&mon->seg->head, __ATOMIC_ACQUIRE);
+}
+
+void readMonitorCounters(const Monitor *mon, MonitorCounters *counters){
+    const MonitorSegment *seg = mon->seg;
+    for (int tries = 0; tries < READ_RETRIES; tries++){
+        uint32_t before = __atomic_load_n(&seg->counterSeq, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        memcpy(counters, (const void *)&seg->counters, sizeof(*counters));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&seg->counterSeq, __ATOMIC_RELAXED) == before) return;
+    }
+    memset(counters, 0, sizeof(*counters));
+}
+
+int readMonitorEvent(const Monitor *mon, uint64_t index, MonitorEvent *ev){
+    const MonitorSlot *slot = &mon->seg->slot[index % MONITOR_SLOTS];
+    for (int tries = 0; tries < READ_RETRIES; tries++){
+        uint32_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        memcpy(ev, (const void *)&slot->ev, sizeof(*ev));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == before)
+            return ev->index == index ? 0 : -1;
+    }
+    return -1;
+}
@@ -0,0 +1,67 @@
+#ifndef XYMONITOR_H
+#define XYMONITOR_H
+
+#include <stdint.h>
+#include "xypicmic.h"
+
+// Live monitoring feed in POSIX shared memory (shm_open), written by the reconstruction and
+// read by any number of monitor processes. The writer never waits for a reader: the run
+// counters and every slot of the ring of recent events are guarded by a seqlock (sequence
+// odd while written), a reader copies the data and retries when the sequence moved.
+// A slot overwritten before it was read is reported as lost, never as mixed data.
+
+#define MONITOR_MAGIC 0x4e4f4d58        // "XMON"
+#define MONITOR_VERSION 2
+#define MONITOR_SLOTS 1024              // recent events kept, power of 2
+#define MONITOR_MAX_CENTROIDS 32        // centroids kept per event, the count is exact
+
+typedef struct {
+    double x;
+    double y;
+    int32_t flag;
+    int32_t num;
+    int32_t intersects;
+    int32_t reserved;
+} MonitorCentroid;
+
+typedef struct {
+    uint64_t events;
+    uint64_t failed;
+    uint64_t hits;
+    uint64_t intersections;             // every event but the failed ones, cache hits included
+    uint64_t centroids;
+    uint64_t centroids3;                // 3-color centroids, those written to the csv output
+    uint64_t degraded;                  // events over the work budget (BUDGET_*)
+    uint64_t skipped;
+    int64_t startTime;                  // CLOCK_REALTIME, ns
+    int64_t updateTime;
+} MonitorCounters;
+
+typedef struct {
+    uint64_t index;                     // position in the feed, slot = index % MONITOR_SLOTS
+    int64_t event;
+    int32_t nHits;
+    int32_t interCount;                 // -1 when the event failed, the stored count for a cache hit
+    int32_t nCentroids;                 // -1 when the event failed
+    int32_t kept;                       // centroids[] entries, 3-color centroids first
+    int32_t budget;                     // BUDGET_* outcome
+    int32_t reserved;
+    MonitorCentroid centroids[MONITOR_MAX_CENTROIDS];
+} MonitorEvent;
+
+typedef struct Monitor Monitor;
+
+// Writer side: creates (or takes over) the segment, publishMonitorEvent() is thread safe
+Monitor *createMonitor(const char *name);
+void publishMonitorEvent(Monitor *mon, int64_t event, int nHits, int interCount,
+                         const IntersectionPoint *centroids, int nCentroids, int budget);
+void closeMonitor(Monitor *mon);                    // the segment stays for the readers
+int removeMonitor(const char *name);
+
+// Reader side, lock free
+Monitor *openMonitor(const char *name);
+uint64_t monitorHead(const Monitor *mon);           // events published so far
+void readMonitorCounters(const Monitor *mon, MonitorCounters *counters);
+int readMonitorEvent(const Monitor *mon, uint64_t index, MonitorEvent *ev);  // 0, or -1 if overwritten
+
+#endif /* XYMONITOR_H */
@@ -0,0 +1,239 @@
+// Event archive tool (format in xyarchive.h).
+//   xypack.exe -p <event file|-> <archive> [-e <events per block>] [-u]   pack, -u drops the readout order
+//   xypack.exe -x <archive>                                              unpack to the text format on stdout
+//   xypack.exe -d <archive> [-t <threads>]                               decode speed, blocks in parallel
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "xyarchive.h"
+#include "xybatch.h"
+#include "xyformat.h"
+
+#define MAX_THREADS 64
+
+static void usage(const char *prog){
+    printf("Usage: %s -p <event file|-> <archive> [-e <events per block>] [-u]\n", prog);
+    printf("       %s -x <archive>\n", prog);
+    printf("       %s -d <archive> [-t <threads>]\n", prog);
+}
+
+static int pack(const char *input, const char *output, int blockEvents, int keepOrder){
+    FILE *in = strcmp(input, "-") == 0 ? stdin : fopen(input, "rb");
+    if (in == NULL){
+        perror(input);
+        return 1;
+    }
+    FILE *out = fopen(output, "wb");
+    if (out == NULL){
+        perror(output);
+        return 1;
+    }
+    ArchiveWriter *w = createArchiveWriter(out, blockEvents, keepOrder);
+    if (w == NULL){
+        fprintf(stderr, "Cannot write %s\n", output);
+        return 1;
+    }
+    EventSource src;
+    if (openEventSource(&src, in) != 0) return 1;
+    PixelHit *hits = NULL; int hitCap = 0, nHits = 0, rc;
+    int status = 0;
+    long events = 0;
+    while ((rc = readEvent(&src, &hits, &hitCap, &nHits)) != 0){
+        if (rc < 0){
+            status = 1;
+            continue;
+        }
+        if (writeArchiveEvent(w, hits, nHits) != 0){
+            fprintf(stderr, "Cannot write event %ld\n", events);
+            status = 1;
+            break;
+        }
+        events++;
+    }
+    long textBytes = in != stdin ? ftell(in) : -1;
+    if (closeArchiveWriter(w) != 0 || fclose(out) != 0){
+        perror(output);
+        status = 1;
+    }
+    out = fopen(output, "rb");
+    if (out != NULL){
+        fseek(out, 0, SEEK_END);
+        long bytes = ftell(out);
+        fprintf(stderr, "%ld events, %ld bytes", events, bytes);
+        if (textBytes > 0) fprintf(stderr, " (%.1f%% of the text)", 100.0 * bytes / textBytes);
+        fprintf(stderr, "\n");
+        fclose(out);
+    }
+    if (in != stdin) fclose(in);
+    closeEventSource(&src);
+    free(hits);
+    return status;
+}
+
+static int unpack(const char *input){
+    FILE *in = fopen(input, "rb");
+    if (in == NULL){
+        perror(input);
+        return 1;
+    }
+    ArchiveReader *r = openArchiveReader(in);
+    if (r == NULL) return 1;
+    TextBuffer text;
+    initTextBuffer(&text, stdout, TEXT_BUFFER_SIZE);
+    PixelHit *hits = NULL; int hitCap = 0, nHits = 0, rc;
+    while ((rc = readArchiveEvent(r, &hits, &hitCap, &nHits)) > 0){
+        putInt(&text, nHits);
+        for (int i = 0; i < nHits; i++){
+            putChar(&text, ' ');
+            putInt(&text, hits[i].row);
+            putChar(&text, ' ');
+            putInt(&text, hits[i].col);
+        }
+        putChar(&text, '\n');
+    }
+    freeTextBuffer(&text);
+    closeArchiveReader(r);
+    fclose(in);
+    free(hits);
+    return rc < 0;
+}
+
+typedef struct {
+    ArchiveBlockHeader header;
+    unsigned char *payload;
+} Block;
+
+typedef struct {
+    Block *blocks;
+    int first;
+    int last;
+    long hits;
+    int failed;
+} DecodeTask;
+
+static void *decodeRange(void *arg){
+    DecodeTask *t = (DecodeTask *)arg;
+    PixelHit *hits = NULL; int hitCap = 0;
+    int *counts = NULL; int countCap = 0;
+    for (int b = t->first; b < t->last && !t->failed; b++){
+        const ArchiveBlockHeader *h = &t->blocks[b].header;
+        if (2*(int)h->nHits + 1 > hitCap){
+            hitCap = 2*(int)h->nHits + 1;
+            free(hits);
+            hits = (PixelHit *)malloc(hitCap * sizeof(PixelHit));
+        }
+        if ((int)h->nEvents > countCap){
+            countCap = (int)h->nEvents;
+            free(counts);
+            counts = (int *)malloc(countCap * sizeof(int));
+        }
+        int n = hits && counts ? decodeArchiveBlock(t->blocks[b].payload, h->payloadBytes, (int)h->nEvents, hits, hitCap, counts) : -1;
+        if (n < 0) t->failed = 1;
+        else t->hits += n;
+    }
+    free(hits);
+    free(counts);
+    return NULL;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static int decodeSpeed(const char *input, int threads){
+    FILE *in = fopen(input, "rb");
+    if (in == NULL){
+        perror(input);
+        return 1;
+    }
+    ArchiveReader *r = openArchiveReader(in);
+    if (r == NULL) return 1;
+    closeArchiveReader(r);
+
+    Block *blocks = NULL;
+    int nBlocks = 0, blockCap = 0, rc;
+    long events = 0, bytes = 0;
+    for (;;){
+        if (nBlocks == blockCap){
+            blockCap = blockCap ? 2*blockCap : 64;
+            Block *b = (Block *)realloc(blocks, blockCap * sizeof(Block));
+            if (b == NULL) return 1;
+            blocks = b;
+        }
+        size_t cap = 0;
+        blocks[nBlocks].payload = NULL;
+        rc = readArchiveBlock(in, &blocks[nBlocks].header, &blocks[nBlocks].payload, &cap);
+        if (rc <= 0) break;
+        events += blocks[nBlocks].header.nEvents;
+        bytes += blocks[nBlocks].header.payloadBytes + sizeof(ArchiveBlockHeader);
+        nBlocks++;
+    }
+    fclose(in);
+    if (rc < 0){
+        fprintf(stderr, "Truncated archive block\n");
+        return 1;
+    }
+
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    DecodeTask tasks[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    memset(tasks, 0, sizeof(tasks));
+    double t0 = now();
+    for (int k = 0; k < threads; k++){
+        tasks[k].blocks = blocks;
+        tasks[k].first = (int)((long)nBlocks * k / threads);
+        tasks[k].last = (int)((long)nBlocks * (k + 1) / threads);
+        if (k > 0 && pthread_create(&tids[k], NULL, decodeRange, &tasks[k]) != 0) decodeRange(&tasks[k]), tids[k] = 0;
+    }
+    decodeRange(&tasks[0]);
+    long hits = tasks[0].hits;
+    int failed = tasks[0].failed;
+    for (int k = 1; k < threads; k++){
+        if (tids[k]) pthread_join(tids[k], NULL);
+        hits += tasks[k].hits;
+        failed |= tasks[k].failed;
+    }
+    double seconds = now() - t0;
+    printf("%d blocks, %ld events, %ld hits, %.2f bytes/hit: %.1f Mevents/s, %.1f MB/s on %d threads\n",
+           nBlocks, events, hits, hits ? (double)bytes / hits : 0.0, events / seconds * 1e-6, bytes / seconds * 1e-6, threads);
+    for (int b = 0; b < nBlocks; b++) free(blocks[b].payload);
+    free(blocks);
+    if (failed) fprintf(stderr, "Corrupt archive block\n");
+    return failed;
+}
+
+int main(int argc, char *argv[]){
+    int blockEvents = ARCHIVE_BLOCK_EVENTS, keepOrder = 1, threads = 1;
+    const char *mode = NULL, *first = NULL, *second = NULL;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) blockEvents = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-u") == 0) keepOrder = 0;
+        else if ((strcmp(argv[i], "-p") == 0 && i + 2 < argc)){
+            mode = argv[i];
+            first = argv[++i];
+            second = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-x") == 0 || strcmp(argv[i], "-d") == 0) && i + 1 < argc){
+            mode = argv[i];
+            first = argv[++i];
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (mode == NULL){
+        usage(argv[0]);
+        return 1;
+    }
+    if (mode[1] == 'p') return pack(first, second, blockEvents, keepOrder);
+    if (mode[1] == 'x') return unpack(first);
+    return decodeSpeed(first, threads);
+}
@@ -0,0 +1,285 @@
+#include "xyparallel.h"
+#include "xylut.h"
+#include "xyprobe.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#define MAX_THREADS 64
+
+typedef struct {
+    long long key;                      // grid cell
+    int index;
+} CellEntry;
+
+typedef struct {
+    EventResult *res;
+    int threshold;
+    int first;                          // range of rows (pairs) or seeds (clustering)
+    int last;
+    const CellEntry *cells;
+    int nCells;
+    int *start;                         // per intersection, offset of its neighbors in adj
+    int *count;
+    int *adj;                           // neighbors j > i closer than threshold, ascending
+    int adjSize;
+    int adjCap;
+    int failed;
+} ParallelTask;
+
+static long long cellKey(long long cx, long long cy){
+    return (long long)(((unsigned long long)cx << 32) ^ ((unsigned long long)cy & 0xFFFFFFFFULL));
+}
+
+static long long cellOf(double v, int threshold){
+    return (long long)floor(v / threshold);
+}
+
+static int compareCells(const void *a, const void *b){
+    const CellEntry *x = (const CellEntry *)a, *y = (const CellEntry *)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->index - y->index;
+}
+
+static int compareInt(const void *a, const void *b){
+    return *(const int *)a - *(const int *)b;
+}
+
+// ----------------------------------------------------------------
+// pairs: row k < y_size is yellow line k (R then B partners),
+// row y_size + k is red line k (B partners), as in xLines()
+// ----------------------------------------------------------------
+
+static void *pairRows(void *arg){
+    ParallelTask *t = (ParallelTask *)arg;
+    EventResult *res = t->res;
+    LineCoordinates *ylines = res->split, *rlines = ylines + res->y_size, *blines = rlines + res->r_size;
+    int y = res->y_size, r = res->r_size, b = res->b_size;
+    const IntersectionLUT *lut = intersectionLUT;
+    for (int row = t->first; row < t->last; row++){
+        if (lut != NULL && row < y){
+            IntersectionPoint *out = res->intersections + row*(r + b);
+            for (int j = 0; j < r; j++) out[j] = lutIntersection(lut, LUT_YR, COMBINATION_YR, &ylines[row], &rlines[j]);
+            for (int k = 0; k < b; k++) out[r + k] = lutIntersection(lut, LUT_YB, COMBINATION_YB, &ylines[row], &blines[k]);
+        }
+        else if (lut != NULL){
+            int idx = row - y;
+            IntersectionPoint *out = res->intersections + y*(r + b) + idx*b;
+            for (int j = 0; j < b; j++) out[j] = lutIntersection(lut, LUT_RB, COMBINATION_RB, &rlines[idx], &blines[j]);
+        }
+        else if (row < y){
+            IntersectionPoint *out = res->intersections + row*(r + b);
+            for (int j = 0; j < r; j++) out[j] = calculateIntersection(ylines[row], rlines[j]);
+            for (int k = 0; k < b; k++) out[r + k] = calculateIntersection(ylines[row], blines[k]);
+        }
+        else {
+            int idx = row - y;
+            IntersectionPoint *out = res->intersections + y*(r + b) + idx*b;
+            for (int j = 0; j < b; j++) out[j] = calculateIntersection(rlines[idx], blines[j]);
+        }
+    }
+    return NULL;
+}
+
+// ----------------------------------------------------------------
+// neighbor lists through the grid
+// ----------------------------------------------------------------
+
+static int findCell(const CellEntry *cells, int n, long long key){
+    int lo = 0, hi = n;
+    while (lo < hi){
+        int mid = (lo + hi) / 2;
+        if (cells[mid].key < key) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void *neighborRange(void *arg){
+    ParallelTask *t = (ParallelTask *)arg;
+    const IntersectionPoint *pts = t->res->intersections;
+    for (int i = t->first; i < t->last; i++){
+        long long cx = cellOf(pts[i].x, t->threshold), cy = cellOf(pts[i].y, t->threshold);
+        int from = t->adjSize;
+        for (long long dx = -1; dx <= 1; dx++){
+            for (long long dy = -1; dy <= 1; dy++){
+                long long key = cellKey(cx + dx, cy + dy);
+                for (int c = findCell(t->cells, t->nCells, key); c < t->nCells && t->cells[c].key == key; c++){
+                    int j = t->cells[c].index;
+                    if (j <= i) continue;
+                    if (distance(pts[i].x, pts[i].y, pts[j].x, pts[j].y) >= t->threshold) continue;
+                    if (t->adjSize == t->adjCap){
+                        int cap = t->adjCap ? 2*t->adjCap : 1024;
+                        int *adj = (int *)realloc(t->adj, cap * sizeof(int));
+                        if (adj == NULL){
+                            t->failed = 1;
+                            return NULL;
+                        }
+                        t->adj = adj;
+                        t->adjCap = cap;
+                    }
+                    t->adj[t->adjSize++] = j;
+                }
+            }
+        }
+        if (t->adjSize - from > 1) qsort(t->adj + from, t->adjSize - from, sizeof(int), compareInt);
+        t->start[i] = from;
+        t->count[i] = t->adjSize - from;
+    }
+    return NULL;
+}
+
+// Runs fn over nTasks tasks, the calling thread taking the first one
+static void runTasks(void *(*fn)(void *), ParallelTask *tasks, int nTasks){
+    pthread_t threads[MAX_THREADS];
+    int started[MAX_THREADS];
+    for (int k = 1; k < nTasks; k++) started[k] = pthread_create(&threads[k], NULL, fn, &tasks[k]) == 0;
+    fn(&tasks[0]);
+    for (int k = 1; k < nTasks; k++){
+        if (started[k]) pthread_join(threads[k], NULL);
+        else fn(&tasks[k]);
+    }
+}
+
+// Greedy seed scan of clusterIntersections() over the neighbor lists
+static int greedyFromNeighbors(EventResult *res, ParallelTask *tasks, int *owner){
+    int n = res->interCount;
+    unsigned char *clustered = (unsigned char *)calloc(n, 1);
+    IntersectionPoint *cluster = (IntersectionPoint *)malloc(n * sizeof(IntersectionPoint));
+    if (clustered == NULL || cluster == NULL){
+        free(clustered);
+        free(cluster);
+        return -1;
+    }
+    int fillCounter = -1;
+    for (int k = 0; k < n; k++) res->clusterOf[k] = -1;
+    for (int i = 0; i < n-1; i++){
+        if (clustered[i]) continue;
+        int numeroCluster = fillCounter + 1;
+        int clusterSize = 0;
+        cluster[clusterSize] = res->intersections[i];
+        cluster[clusterSize++].num = numeroCluster;
+        clustered[i] = 1;
+        res->clusterOf[i] = numeroCluster;
+        const ParallelTask *t = &tasks[owner[i]];
+        const int *adj = t->adj + t->start[i];
+        for (int k = 0; k < t->count[i]; k++){
+            int j = adj[k];
+            if (clustered[j]) continue;
+            cluster[clusterSize] = res->intersections[j];
+            cluster[clusterSize++].num = numeroCluster;
+            clustered[j] = 1;
+            res->clusterOf[j] = numeroCluster;
+        }
+        res->centroids[++fillCounter] = calculateCentroid(cluster, clusterSize);
+    }
+    res->nClusters = fillCounter + 1;
+    free(clustered);
+    free(cluster);
+    return 0;
+}
+
+static int clusterParallel(EventResult *res, int threshold, ParallelTask *tasks, int nTasks){
+    int n = res->interCount;
+    CellEntry *cells = (CellEntry *)malloc(n * sizeof(CellEntry));
+    int *start = (int *)malloc(n * sizeof(int));
+    int *count = (int *)calloc(n, sizeof(int));
+    int *owner = (int *)malloc(n * sizeof(int));
+    int status = -1;
+    if (cells == NULL || start == NULL || count == NULL || owner == NULL) goto done;
+
+    for (int i = 0; i < n; i++){
+        cells[i].key = cellKey(cellOf(res->intersections[i].x, threshold), cellOf(res->intersections[i].y, threshold));
+        cells[i].index = i;
+    }
+    qsort(cells, n, sizeof(CellEntry), compareCells);
+
+    for (int k = 0; k < nTasks; k++){
+        tasks[k].first = (int)((long long)n * k / nTasks);
+        tasks[k].last = (int)((long long)n * (k + 1) / nTasks);
+        tasks[k].threshold = threshold;
+        tasks[k].cells = cells;
+        tasks[k].nCells = n;
+        tasks[k].start = start;
+        tasks[k].count = count;
+        for (int i = tasks[k].first; i < tasks[k].last; i++) owner[i] = k;
+    }
+    runTasks(neighborRange, tasks, nTasks);
+    for (int k = 0; k < nTasks; k++){
+        if (tasks[k].failed) goto done;
+    }
+    status = greedyFromNeighbors(res, tasks, owner);
+
+done:
+    for (int k = 0; k < nTasks; k++) free(tasks[k].adj);
+    free(cells);
+    free(start);
+    free(count);
+    free(owner);
+    return status;
+}
+
+static int reconstructSplit(const PixelHit *hits, int nHits, int threshold, EventResult *res, int threads){
+    res->threshold = threshold;
+    res->interCount = 0;
+    res->nClusters = 0;
+    if (reserveEventResult(res, nHits, 0) != 0) return -1;
+    XY_PROBE2(fill_lines_entry, res->event, nHits);
+    res->nLines = fillLinesFromHits(hits, nHits, res->lines, &res->y_size, &res->r_size, &res->b_size);
+    LineCoordinates *ylines = res->split;
+    LineCoordinates *rlines = ylines + res->y_size;
+    LineCoordinates *blines = rlines + res->r_size;
+    splitLineColor(res->lines, res->nLines, ylines, rlines, blines);
+    XY_PROBE4(fill_lines_exit, res->event, res->y_size, res->r_size, res->b_size);
+
+    int y = res->y_size, r = res->r_size, b = res->b_size;
+    int combinations = y*r + y*b + b*r;
+    if (combinations == 0) return 0;
+    if (reserveEventResult(res, nHits, combinations) != 0) return -1;
+
+    // rows balanced by the number of pairs they produce
+    XY_PROBE4(xlines_entry, res->event, y, r, b);
+    ParallelTask tasks[MAX_THREADS];
+    memset(tasks, 0, sizeof(tasks));
+    int rows = y + (b > 0 ? r : 0);
+    int row = 0, done = 0;
+    for (int k = 0; k < threads; k++){
+        tasks[k].res = res;
+        tasks[k].first = row;
+        long long target = (long long)combinations * (k + 1) / threads;
+        while (row < rows && (k == threads - 1 || done < target)){
+            done += row < y ? r + b : b;
+            row++;
+        }
+        tasks[k].last = row;
+    }
+    runTasks(pairRows, tasks, threads);
+    res->interCount = combinations;
+    XY_PROBE2(xlines_exit, res->event, res->interCount);
+
+    XY_PROBE3(fill_centroids_entry, res->event, res->interCount, threshold);
+    int status = 0;
+    if (res->interCount == 1){
+        res->centroids[0] = res->intersections[0];
+        res->nClusters = 1;
+        res->clusterOf[0] = 0;
+    }
+    else {
+        init_array(res->centroids, res->interCount);
+        memset(tasks, 0, sizeof(tasks));
+        for (int k = 0; k < threads; k++) tasks[k].res = res;
+        status = clusterParallel(res, threshold, tasks, threads);
+    }
+    XY_PROBE3(fill_centroids_exit, res->event, res->interCount, res->nClusters);
+    return status;
+}
+
+int reconstructEventParallel(const PixelHit *hits, int nHits, int threshold, EventResult *res, int threads){
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads < 2) return reconstructEvent(hits, nHits, threshold, res);
+    return reconstructSplit(hits, nHits, threshold, res, threads);
+}
+
+int reconstructEventGrid(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    return reconstructSplit(hits, nHits, threshold, res, 1);
+}
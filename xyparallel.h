@@ -0,0 +1,18 @@
+#ifndef XYPARALLEL_H
+#define XYPARALLEL_H
+
+#include "xypicmic.h"
+
+// Threaded reconstruction of one large event, same result as reconstructEvent() bit for bit.
+// The Y-R, Y-B and R-B pairs are split across threads, each writing its pairs at their
+// xLines() position. The distance tests of the clustering are done by the threads through a
+// spatial grid (cell size = threshold) and the greedy seed scan of fillCentroids() is then
+// replayed serially over the sorted neighbor lists.
+
+int reconstructEventParallel(const PixelHit *hits, int nHits, int threshold, EventResult *res, int threads);
+
+// The same grid clustering on the calling thread only: no thread start-up, and the distance
+// tests no longer grow with the square of the number of intersections.
+int reconstructEventGrid(const PixelHit *hits, int nHits, int threshold, EventResult *res);
+
+#endif /* XYPARALLEL_H */
@@ -1,9 +1,14 @@
 #include "xypicmic.h"
+#include "xyprobe.h"
+#include "xylut.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+unsigned char hotPixelMask[(NUM_PIXELS+7)/8];
+const IntersectionLUT *intersectionLUT;
+
 void printIntersectionPoint(IntersectionPoint *item, int numIP) {
   //   printf("Printing %d persons:\n", numIP);
     for (int i = 0; i < numIP; ++i) {
@@ -75,6 +80,41 @@ LineCoordinates calculateLineCoordinates(char lineType, int value) {
     return coords;
 }
 
+// Inverse of calculateLineCoordinates(): Y, R and B strip coordinates of (x, y), in strips
+// (the strip number at the strip center, 7.5 um across in all three colors)
+void stripCoordinates(double x, double y, double u[3]) {
+    double Ymax = 852*7.5*0.5;
+    double tang60 = sqrt(3);
+    double Xmax = (Ymax*2)/sqrt(3);
+    double deltax = Xmax*(2./852);
+    double t = (y + Ymax) / (2*Ymax);         // fraction of the way from y = -Ymax to y = Ymax
+
+    u[0] = y/7.5 + 426;
+    u[1] = (Ymax/tang60 + t*Xmax - x) / deltax;
+    u[2] = (x + Xmax + Ymax/tang60 - (1 - t)*Xmax) / deltax;
+}
+
+// Nearest Y, R and B strip numbers through (x, y)
+void stripsAtPoint(double x, double y, int strips[3]) {
+    double u[3];
+    stripCoordinates(x, y, u);
+    for (int c = 0; c < 3; c++) strips[c] = (int)lround(u[c]);
+}
+
+short stripPixel[3][STRIP_SLOTS];
+
+// Reverse of the address table, strip -> row*COLS+col (-1 when not read out). Call once
+// before using stripPixel, and before starting threads.
+void initStripPixelTable(void) {
+    memset(stripPixel, 0xFF, sizeof(stripPixel));
+    for (int row = 0; row < ROWS; row++) {
+        for (int col = 0; col < COLS; col++) {
+            int color = assign_number(arr[row][col][0]);
+            if (color >= 0) stripPixel[color][atoi(&arr[row][col][1])] = (short)(row*COLS + col);
+        }
+    }
+}
+
 IntersectionPoint calculateIntersection(LineCoordinates line1, LineCoordinates line2) {
     IntersectionPoint result = {INFINITY, INFINITY, false, 1};
     double denominator = (line1.x_start - line1.x_end) * (line2.y_start - line2.y_end) -
@@ -138,6 +178,18 @@ void splitLineColor(LineCoordinates *Items, int nItems, LineCoordinates *ly, Lin
 
 void xLines(IntersectionPoint *intersecs, int nIntersecs,LineCoordinates *yellow, int y_size, LineCoordinates *red, int r_size, LineCoordinates * blue, int b_size, int * counter){
         int iCount =0;
+        const IntersectionLUT *lut = intersectionLUT;
+        if (lut != NULL){                   // same pairs, in the same order, from the tables
+            for (int idx = 0; idx < y_size; idx++){
+                for (int jdx = 0; jdx < r_size; jdx++) intersecs[iCount++] = lutIntersection(lut, LUT_YR, COMBINATION_YR, &yellow[idx], &red[jdx]);
+                for (int kdx = 0; kdx < b_size; kdx++) intersecs[iCount++] = lutIntersection(lut, LUT_YB, COMBINATION_YB, &yellow[idx], &blue[kdx]);
+            }
+            for (int idx = 0; idx < r_size; idx++){
+                for (int jdx = 0; jdx < b_size; jdx++) intersecs[iCount++] = lutIntersection(lut, LUT_RB, COMBINATION_RB, &red[idx], &blue[jdx]);
+            }
+            *counter = iCount;
+            return;
+        }
         //printf("----------------------------------\n");
         if (y_size>0){
             for (int idx = 0 ; idx<y_size; idx++){              // Yellow lines Loop
@@ -165,23 +217,47 @@ void xLines(IntersectionPoint *intersecs, int nIntersecs,LineCoordinates *yellow
     *counter=iCount;
 }
 
-void fillCentroids(int cut, IntersectionPoint *myIntersections, int myDimIntersections,IntersectionPoint * arrayCentroid, int nCentroid ){
+// Returns the number of clusters, -1 when the clustering buffers cannot be allocated (reported)
+int fillCentroids(int cut, IntersectionPoint *myIntersections, int myDimIntersections,IntersectionPoint * arrayCentroid, int nCentroid ){
+    TextBuffer trace;
+    int nClusters = 0;
+    int *clustered = (int *)malloc(myDimIntersections * sizeof(int));
+    IntersectionPoint *cluster = (IntersectionPoint *)malloc(myDimIntersections * sizeof(IntersectionPoint));
+    if (clustered == NULL || cluster == NULL){
+        fprintf(stderr, "Cannot allocate the clustering of %d intersections\n", myDimIntersections);
+        free(clustered);
+        free(cluster);
+        return -1;
+    }
+    initTextBuffer(&trace, stdout, 64 << 10);
+    clusterIntersections(cut, myIntersections, myDimIntersections, arrayCentroid, &nClusters, NULL, clustered, cluster, &trace);
+    freeTextBuffer(&trace);
+    free(clustered);
+    free(cluster);
+    return nClusters;
+}
+
+// Greedy clustering behind fillCentroids(); members are printed to `trace` when it is not NULL
+// and the cluster of each intersection is stored in clusterOf (-1 if left out) when given.
+// myclustered and cluster are scratch arrays of myDimIntersections entries (EventResult keeps
+// them), so that the stack does not grow with the event.
+void clusterIntersections(int cut, IntersectionPoint *myIntersections, int myDimIntersections, IntersectionPoint *arrayCentroid, int *nClusters, int *clusterOf,
+                          int *myclustered, IntersectionPoint *cluster, TextBuffer *trace){
 
-    int max_interactions = myDimIntersections;
-    int myclustered[max_interactions];
-    memset(myclustered,0,max_interactions*sizeof(int));
+    memset(myclustered,0,myDimIntersections*sizeof(int));
     int fillCounter = -1;
+    if (clusterOf != NULL) for (int k = 0; k < myDimIntersections; k++) clusterOf[k] = -1;
 
     for (int i = 0; i < myDimIntersections-1; i++) { 
         int numeroCluster = fillCounter;
         //fillCounter++;
         if (!myclustered[i]) {
-            IntersectionPoint cluster[myDimIntersections];      // Tableau temporaire pour stocker un cluster de points.
             numeroCluster++;
             int clusterSize = 0;                                // Taille du cluster.
             cluster[clusterSize] = myIntersections[i]; 
             cluster[clusterSize++].num = numeroCluster;
             myclustered[i] = 1;                                 // Marquage du point comme regroupé.
+            if (clusterOf != NULL) clusterOf[i] = numeroCluster;
             // Recherche d'autres points à inclure dans le cluster.
             for (int j = i + 1; j < myDimIntersections; j++) {
                 if (!myclustered[j]) {
@@ -190,15 +266,21 @@ void fillCentroids(int cut, IntersectionPoint *myIntersections, int myDimInterse
                         cluster[clusterSize] = myIntersections[j]; // Ajout du point au cluster.
                         cluster[clusterSize++].num = numeroCluster;
                         myclustered[j] = 1;                           // Marquage du point comme regroupé.
+                        if (clusterOf != NULL) clusterOf[j] = numeroCluster;
                     }
                 }
             }
             IntersectionPoint centroid = calculateCentroid(cluster, clusterSize);
             fillCounter++;
             //printf("INSIDE Centroid --> x=%0.2f ,\t y=%0.2f \t , flag=%d, is3Colors=%d, fillCounterValue=%d ,  numClusters=%d\n",centroid.x,centroid.y,centroid.flag,centroid.intersects,fillCounter,centroid.num);
-            if (fillCounter>-1){
+            if (fillCounter>-1 && trace != NULL){
                 for (int t = 0 ; t<clusterSize; t++ ){
-                    printf("%d;%0.2f;%0.2f \n",fillCounter,cluster[t].x,cluster[t].y);
+                    putInt(trace, fillCounter);     // "%d;%0.2f;%0.2f \n"
+                    putChar(trace, ';');
+                    putFixed(trace, cluster[t].x, 2);
+                    putChar(trace, ';');
+                    putFixed(trace, cluster[t].y, 2);
+                    putText(trace, " \n");
                     //fprintf(csvFile3,"%d;%0.2f;%0.2f\n",fillCounter,cluster[t].x,cluster[t].y);
                 }
             }
@@ -210,6 +292,7 @@ void fillCentroids(int cut, IntersectionPoint *myIntersections, int myDimInterse
             
         }
     }
+    if (nClusters != NULL) *nClusters = fillCounter+1;
 
 }
 
@@ -226,6 +309,9 @@ void fillLines(char *arguments[], LineCoordinates *allLines, int nLines, int *ye
             if (lineType == 'D') {
                 printf("For Row %d, Column %d: This is a dummy cell.\n", inputRow, inputCol);
             } 
+            else if (PIXEL_MASKED(inputRow, inputCol)) {
+                printf("For Row %d, Column %d: This is a masked cell.\n", inputRow, inputCol);
+            } 
             else {
                 int lineValue = atoi(&value[1]); // Conversion de la valeur de la ligne en entier.
                 //printf("----------------> correct value =%d\n",lineValue);
@@ -247,6 +333,171 @@ void fillLines(char *arguments[], LineCoordinates *allLines, int nLines, int *ye
     *blueSize = temp_b;
 }
 
+// Same as fillLines() but from decoded hits; dummy, masked and out of range cells are skipped
+// silently and the valid strips are packed at the front of allLines.
+int fillLinesFromHits(const PixelHit *hits, int nHits, LineCoordinates *allLines, int *yellowSize, int *redSize, int *blueSize){
+    int temp_y= 0; int temp_r=0; int temp_b=0; int nLines=0;
+
+    for (int i = 0; i < nHits; i++) {
+        int inputRow = hits[i].row;
+        int inputCol = hits[i].col;
+        if (inputRow < 0 || inputRow >= ROWS || inputCol < 0 || inputCol >= COLS) continue;
+        if (PIXEL_MASKED(inputRow, inputCol)) continue;
+
+        char *value = arr[inputRow][inputCol];
+        char lineType = value[0];
+        if (lineType == 'Y') temp_y+=1;
+        else if (lineType == 'R') temp_r+=1;
+        else if (lineType == 'B') temp_b+=1;
+        else continue;
+
+        allLines[nLines++] = calculateLineCoordinates(lineType, atoi(&value[1]));
+    }
+    *yellowSize = temp_y;
+    *redSize = temp_r;
+    *blueSize = temp_b;
+    return nLines;
+}
+
+void initEventResult(EventResult *res){
+    memset(res, 0, sizeof(EventResult));
+}
+
+void freeEventResult(EventResult *res){
+    free(res->lines);
+    free(res->split);
+    free(res->intersections);
+    free(res->centroids);
+    free(res->clusterOf);
+    free(res->clustered);
+    free(res->cluster);
+    free(res->memberStart);
+    free(res->members);
+    free(res->interStrips);
+    initEventResult(res);
+}
+
+// Grows the buffers of res to hold nLines strips and nInter intersections
+int reserveEventResult(EventResult *res, int nLines, int nInter){
+    if (nLines > res->lineCap){
+        LineCoordinates *lines = (LineCoordinates *)realloc(res->lines, nLines * sizeof(LineCoordinates));
+        if (lines == NULL) return -1;
+        res->lines = lines;
+        LineCoordinates *split = (LineCoordinates *)realloc(res->split, nLines * sizeof(LineCoordinates));
+        if (split == NULL) return -1;
+        res->split = split;
+        res->lineCap = nLines;
+    }
+    if (nInter > res->interCap){
+        IntersectionPoint *inter = (IntersectionPoint *)realloc(res->intersections, nInter * sizeof(IntersectionPoint));
+        if (inter == NULL) return -1;
+        res->intersections = inter;
+        IntersectionPoint *cent = (IntersectionPoint *)realloc(res->centroids, nInter * sizeof(IntersectionPoint));
+        if (cent == NULL) return -1;
+        res->centroids = cent;
+        int *clusterOf = (int *)realloc(res->clusterOf, nInter * sizeof(int));
+        if (clusterOf == NULL) return -1;
+        res->clusterOf = clusterOf;
+        int *clustered = (int *)realloc(res->clustered, nInter * sizeof(int));
+        if (clustered == NULL) return -1;
+        res->clustered = clustered;
+        IntersectionPoint *cluster = (IntersectionPoint *)realloc(res->cluster, nInter * sizeof(IntersectionPoint));
+        if (cluster == NULL) return -1;
+        res->cluster = cluster;
+        res->interCap = nInter;
+    }
+    return 0;
+}
+
+// Quiet version of the main() chain fillLines -> xLines -> fillCentroids for one event.
+// Returns 0 on success, -1 on allocation failure.
+int reconstructEvent(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    res->threshold = threshold;
+    res->interCount = 0;
+    res->nClusters = 0;
+    if (reserveEventResult(res, nHits, 0) != 0) return -1;
+
+    XY_PROBE2(fill_lines_entry, res->event, nHits);
+    res->nLines = fillLinesFromHits(hits, nHits, res->lines, &res->y_size, &res->r_size, &res->b_size);
+    LineCoordinates *ylines = res->split;
+    LineCoordinates *rlines = ylines + res->y_size;
+    LineCoordinates *blines = rlines + res->r_size;
+    splitLineColor(res->lines, res->nLines, ylines, rlines, blines);
+    XY_PROBE4(fill_lines_exit, res->event, res->y_size, res->r_size, res->b_size);
+
+    int combinations = res->y_size*res->r_size + res->y_size*res->b_size + res->b_size*res->r_size;
+    if (combinations == 0) return 0;
+    if (reserveEventResult(res, nHits, combinations) != 0) return -1;
+    XY_PROBE4(xlines_entry, res->event, res->y_size, res->r_size, res->b_size);
+    xLines(res->intersections, combinations, ylines, res->y_size, rlines, res->r_size, blines, res->b_size, &res->interCount);
+    XY_PROBE2(xlines_exit, res->event, res->interCount);
+
+    XY_PROBE3(fill_centroids_entry, res->event, res->interCount, threshold);
+    if (res->interCount == 1){
+        res->centroids[0] = res->intersections[0];
+        res->nClusters = 1;
+        res->clusterOf[0] = 0;
+    }
+    else {
+        init_array(res->centroids, res->interCount);
+        clusterIntersections(threshold, res->intersections, res->interCount, res->centroids, &res->nClusters, res->clusterOf,
+                             res->clustered, res->cluster, NULL);
+    }
+    XY_PROBE3(fill_centroids_exit, res->event, res->interCount, res->nClusters);
+    return 0;
+}
+
+// Cluster membership of the last reconstructed event in compressed sparse row form: the
+// intersections of cluster c are members[memberStart[c] .. memberStart[c+1]-1], in
+// intersection order, and intersection k lies on the strips interStrips[2k] and
+// interStrips[2k+1] (STRIP_ID). Intersections left out by the greedy scan are in no cluster.
+// Strip ownership resolution (xyresolve.h) builds no intersections: its nClusters hits come
+// out as empty clusters, with interCount 0. Returns 0 on success, -1 on allocation failure.
+int buildClusterMembers(EventResult *res){
+    int n = res->interCount;
+    int need = (n > res->nClusters ? n : res->nClusters) + 1;      // memberStart has nClusters + 1
+    if (need > res->memberCap){
+        int *start = (int *)realloc(res->memberStart, need * sizeof(int));
+        if (start == NULL) return -1;
+        res->memberStart = start;
+        int *members = (int *)realloc(res->members, need * sizeof(int));
+        if (members == NULL) return -1;
+        res->members = members;
+        unsigned short *strips = (unsigned short *)realloc(res->interStrips, 2 * need * sizeof(unsigned short));
+        if (strips == NULL) return -1;
+        res->interStrips = strips;
+        res->memberCap = need;
+    }
+
+    // counting sort of the intersections by cluster
+    memset(res->memberStart, 0, (res->nClusters + 1) * sizeof(int));
+    for (int k = 0; k < n; k++)
+        if (res->clusterOf[k] >= 0) res->memberStart[res->clusterOf[k] + 1]++;
+    for (int c = 0; c < res->nClusters; c++) res->memberStart[c + 1] += res->memberStart[c];
+    for (int k = 0, c; k < n; k++)
+        if ((c = res->clusterOf[k]) >= 0) res->members[res->memberStart[c]++] = k;
+    for (int c = res->nClusters; c > 0; c--) res->memberStart[c] = res->memberStart[c - 1];
+    res->memberStart[0] = 0;
+
+    // strips from the pair order of xLines(): Y x (R then B), then R x B
+    const LineCoordinates *ylines = res->split, *rlines = ylines + res->y_size, *blines = rlines + res->r_size;
+    int r = res->r_size, b = res->b_size, rowYellow = r + b;
+    for (int k = 0; k < n; k++){
+        const LineCoordinates *first, *second;
+        if (k < res->y_size * rowYellow){
+            first = &ylines[k / rowYellow];
+            second = k % rowYellow < r ? &rlines[k % rowYellow] : &blines[k % rowYellow - r];
+        } else {
+            int m = k - res->y_size * rowYellow;
+            first = &rlines[m / b];
+            second = &blines[m % b];
+        }
+        res->interStrips[2*k] = (unsigned short)STRIP_ID(assign_number(first->type), first->val);
+        res->interStrips[2*k + 1] = (unsigned short)STRIP_ID(assign_number(second->type), second->val);
+    }
+    return 0;
+}
+
 int assign_number(char c) {
     switch(c) {
         case 'Y':
@@ -2,6 +2,8 @@
 #define XYPICMIC_H
 
 #include <stdbool.h>
+#include <stdio.h>
+#include "xyformat.h"
 
 #define COLS 54
 #define ROWS 128
@@ -11,8 +13,21 @@
 #define COMBINATION_YR 3
 #define COMBINATION_YB 7
 #define COMBINATION_RB 5
+#define NUM_PIXELS (ROWS*COLS)
+#define STRIP_SLOTS 854                 // strip numbers run from 0 to 853 in each color
+#define STRIP_ID(color, value) ((color)*STRIP_SLOTS + (value))   // color 0 Y, 1 R, 2 B
+
+// Outcome of the per event work budget (BatchOptions.workBudget)
+#define BUDGET_FULL 0                   // reconstructed as configured
+#define BUDGET_DEGRADED 1               // strip ownership resolution instead of the clustering
+#define BUDGET_SKIPPED 2                // over budget even for the resolution, no centroids
 
 extern char arr[ROWS][COLS][MAX_NAME_LENGTH];
+extern short stripPixel[3][STRIP_SLOTS];      // filled by initStripPixelTable()
+
+// Masked (hot) pixels, one bit per row*COLS+col, skipped by fillLines(); all clear by default
+extern unsigned char hotPixelMask[(NUM_PIXELS+7)/8];
+#define PIXEL_MASKED(row, col) (hotPixelMask[((row)*COLS+(col)) >> 3] & (1u << (((row)*COLS+(col)) & 7)))
 
 typedef struct {
     double x_start;
@@ -31,15 +46,48 @@ typedef struct {
     int num;
 } IntersectionPoint;
 
+typedef struct {
+    int row;
+    int col;
+} PixelHit;
+
+// Reusable per-event workspace: buffers grow on demand and are kept between events
+typedef struct {
+    long event;                         // event number reported by the tracepoints (xyprobe.h)
+    int threshold;
+    int nLines;
+    int y_size;
+    int r_size;
+    int b_size;
+    int interCount;
+    int nClusters;
+    LineCoordinates *lines;             // strips of the event, input order (dummy cells skipped)
+    LineCoordinates *split;             // same strips grouped as Y, then R, then B
+    IntersectionPoint *intersections;
+    IntersectionPoint *centroids;       // nClusters entries
+    int *clusterOf;                     // per intersection, its centroid or -1
+    int *clustered;                     // scratch of clusterIntersections()
+    IntersectionPoint *cluster;
+    int *memberStart;                   // cluster membership in CSR form, see buildClusterMembers()
+    int *members;
+    unsigned short *interStrips;        // 2 strips per intersection
+    int lineCap;
+    int interCap;
+    int memberCap;
+} EventResult;
+
 void replaceBackslashes(char *str);
 double distance(double , double , double , double ); 
 void extractRYBi(const char *, char *);
 LineCoordinates calculateLineCoordinates(char , int );
+void stripCoordinates(double, double, double [3]);
+void stripsAtPoint(double, double, int [3]);
+void initStripPixelTable(void);
 IntersectionPoint calculateIntersection(LineCoordinates line1, LineCoordinates line2);
 IntersectionPoint calculateCentroid(IntersectionPoint *cluster, int size);
 void splitLineColor(LineCoordinates *, int ,LineCoordinates *, LineCoordinates *, LineCoordinates *); 
 void xLines(IntersectionPoint *, int ,LineCoordinates *, int , LineCoordinates *, int , LineCoordinates * , int , int * );
-void fillCentroids(int, IntersectionPoint *, int , IntersectionPoint * , int  );
+int fillCentroids(int, IntersectionPoint *, int , IntersectionPoint * , int  );
 void fillLines(char * [],LineCoordinates *, int, int *, int *, int *);
 int colorFlag(char, char);
 int assign_number(char);
@@ -48,6 +96,13 @@ void printIntersectionPoint0(IntersectionPoint *item);
 void init_array(IntersectionPoint *, int);
 unsigned char fill_bits(unsigned char, int);
 int selThreshold(int);
+int fillLinesFromHits(const PixelHit *, int, LineCoordinates *, int *, int *, int *);
+void clusterIntersections(int, IntersectionPoint *, int, IntersectionPoint *, int *, int *, int *, IntersectionPoint *, TextBuffer *);
+void initEventResult(EventResult *);
+void freeEventResult(EventResult *);
+int reserveEventResult(EventResult *, int, int);
+int reconstructEvent(const PixelHit *, int, int, EventResult *);
+int buildClusterMembers(EventResult *);
 
 
 #endif /* XYPICMIC_H */
@@ -0,0 +1,235 @@
+// Python binding of the reconstruction core:
+//   import xypicmic
+//   lines, intersections, centroids = xypicmic.reconstruct(hits)          # hits: (n, 2) rows/cols
+//   lines, inter, cent, offsets = xypicmic.reconstruct_batch(hits, counts)
+// The returned arrays are structured views on the C buffers (LineCoordinates and
+// IntersectionPoint records), no copy is made; the GIL is released while reconstructing.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xypicmic.h"
+
+static PyArray_Descr *lineDescr;
+static PyArray_Descr *pointDescr;
+
+static void freeCapsule(PyObject *capsule){
+    free(PyCapsule_GetPointer(capsule, NULL));
+}
+
+// Hands a malloc'ed buffer of n records over to a numpy array
+static PyObject *wrapBuffer(void *data, npy_intp n, PyArray_Descr *descr){
+    if (data == NULL) data = malloc(1);             // empty result, numpy still wants an owner
+    Py_INCREF(descr);
+    PyObject *array = PyArray_NewFromDescr(&PyArray_Type, descr, 1, &n, NULL, data, NPY_ARRAY_CARRAY, NULL);
+    if (array == NULL){
+        free(data);
+        return NULL;
+    }
+    PyObject *base = PyCapsule_New(data, NULL, freeCapsule);
+    if (base == NULL || PyArray_SetBaseObject((PyArrayObject *)array, base) != 0){
+        Py_XDECREF(base);
+        Py_DECREF(array);
+        return NULL;
+    }
+    return array;
+}
+
+static PyArrayObject *hitArray(PyObject *obj){
+    PyArrayObject *hits = (PyArrayObject *)PyArray_FROMANY(obj, NPY_INT, 2, 2, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (hits == NULL) return NULL;
+    if (PyArray_DIM(hits, 1) != 2){
+        PyErr_SetString(PyExc_ValueError, "hits must have shape (n, 2): row, col");
+        Py_DECREF(hits);
+        return NULL;
+    }
+    return hits;
+}
+
+static PyObject *takeResult(EventResult *res){
+    PyObject *lines = wrapBuffer(res->lines, res->nLines, lineDescr);
+    res->lines = NULL;
+    PyObject *inter = wrapBuffer(res->intersections, res->interCount, pointDescr);
+    res->intersections = NULL;
+    PyObject *cent = wrapBuffer(res->centroids, res->nClusters, pointDescr);
+    res->centroids = NULL;
+    freeEventResult(res);
+    if (lines == NULL || inter == NULL || cent == NULL){
+        Py_XDECREF(lines); Py_XDECREF(inter); Py_XDECREF(cent);
+        return NULL;
+    }
+    return Py_BuildValue("(NNN)", lines, inter, cent);
+}
+
+static PyObject *py_reconstruct(PyObject *self, PyObject *args, PyObject *kwargs){
+    static char *keywords[] = {"hits", "threshold", NULL};
+    PyObject *obj;
+    int threshold = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", keywords, &obj, &threshold)) return NULL;
+    PyArrayObject *hits = hitArray(obj);
+    if (hits == NULL) return NULL;
+
+    int nHits = (int)PyArray_DIM(hits, 0);
+    const PixelHit *data = (const PixelHit *)PyArray_DATA(hits);
+    if (threshold <= 0) threshold = selThreshold(nHits);
+    EventResult res;
+    initEventResult(&res);
+    int rc;
+    Py_BEGIN_ALLOW_THREADS
+    rc = reconstructEvent(data, nHits, threshold, &res);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(hits);
+    if (rc != 0){
+        freeEventResult(&res);
+        return PyErr_NoMemory();
+    }
+    return takeResult(&res);
+}
+
+static int append(void **buffer, int *cap, int used, const void *data, int n, size_t size){
+    if (used + n > *cap){
+        int newCap = 2*(used + n);
+        void *b = realloc(*buffer, newCap * size);
+        if (b == NULL) return -1;
+        *buffer = b;
+        *cap = newCap;
+    }
+    memcpy((char *)*buffer + used * size, data, n * size);
+    return 0;
+}
+
+// Events of the batch are consecutive blocks of hits, counts[i] hits for event i. The
+// records of all events are concatenated; offsets[i] holds, for event i, the start of its
+// lines, intersections and centroids (one extra row closes the last event).
+static PyObject *py_reconstruct_batch(PyObject *self, PyObject *args, PyObject *kwargs){
+    static char *keywords[] = {"hits", "counts", "threshold", NULL};
+    PyObject *obj, *countObj;
+    int threshold = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|i", keywords, &obj, &countObj, &threshold)) return NULL;
+    PyArrayObject *hits = hitArray(obj);
+    if (hits == NULL) return NULL;
+    PyArrayObject *counts = (PyArrayObject *)PyArray_FROMANY(countObj, NPY_INT, 1, 1, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (counts == NULL){
+        Py_DECREF(hits);
+        return NULL;
+    }
+    int nEvents = (int)PyArray_DIM(counts, 0);
+    const int *count = (const int *)PyArray_DATA(counts);
+    npy_intp total = 0;
+    for (int i = 0; i < nEvents; i++){
+        if (count[i] < 0){
+            PyErr_Format(PyExc_ValueError, "counts[%d] is negative", i);
+            Py_DECREF(hits); Py_DECREF(counts);
+            return NULL;
+        }
+        total += count[i];
+    }
+    if (total != PyArray_DIM(hits, 0)){
+        PyErr_SetString(PyExc_ValueError, "counts must sum to the number of hits");
+        Py_DECREF(hits); Py_DECREF(counts);
+        return NULL;
+    }
+
+    npy_intp offsetDims[2] = {nEvents + 1, 3};
+    PyArrayObject *offsets = (PyArrayObject *)PyArray_ZEROS(2, offsetDims, NPY_INTP, 0);
+    if (offsets == NULL){
+        Py_DECREF(hits); Py_DECREF(counts);
+        return NULL;
+    }
+    npy_intp *off = (npy_intp *)PyArray_DATA(offsets);
+    const PixelHit *data = (const PixelHit *)PyArray_DATA(hits);
+    EventResult res, all;
+    initEventResult(&res);
+    initEventResult(&all);
+    int nLines = 0, nInter = 0, nCent = 0, centCap = 0;
+    int rc = 0;
+
+    Py_BEGIN_ALLOW_THREADS
+    for (int i = 0; i < nEvents && rc == 0; i++){
+        off[3*i] = nLines; off[3*i+1] = nInter; off[3*i+2] = nCent;
+        rc = reconstructEvent(data, count[i], threshold > 0 ? threshold : selThreshold(count[i]), &res);
+        if (rc == 0) rc = append((void **)&all.lines, &all.lineCap, nLines, res.lines, res.nLines, sizeof(LineCoordinates));
+        if (rc == 0) rc = append((void **)&all.intersections, &all.interCap, nInter, res.intersections, res.interCount, sizeof(IntersectionPoint));
+        if (rc == 0) rc = append((void **)&all.centroids, &centCap, nCent, res.centroids, res.nClusters, sizeof(IntersectionPoint));
+        nLines += res.nLines; nInter += res.interCount; nCent += res.nClusters;
+        data += count[i];
+    }
+    off[3*nEvents] = nLines; off[3*nEvents+1] = nInter; off[3*nEvents+2] = nCent;
+    Py_END_ALLOW_THREADS
+
+    freeEventResult(&res);
+    Py_DECREF(hits);
+    Py_DECREF(counts);
+    if (rc != 0){
+        freeEventResult(&all);
+        Py_DECREF(offsets);
+        return PyErr_NoMemory();
+    }
+    all.nLines = nLines;
+    all.interCount = nInter;
+    all.nClusters = nCent;
+    PyObject *result = takeResult(&all);
+    if (result == NULL){
+        Py_DECREF(offsets);
+        return NULL;
+    }
+    PyObject *withOffsets = Py_BuildValue("(OOON)", PyTuple_GET_ITEM(result, 0), PyTuple_GET_ITEM(result, 1),
+                                          PyTuple_GET_ITEM(result, 2), (PyObject *)offsets);
+    Py_DECREF(result);
+    return withOffsets;
+}
+
+static PyObject *py_sel_threshold(PyObject *self, PyObject *args){
+    int nHits;
+    if (!PyArg_ParseTuple(args, "i", &nHits)) return NULL;
+    return PyLong_FromLong(selThreshold(nHits));
+}
+
+// Record layouts shared with the C structs, offsets taken from the compiler
+static PyArray_Descr *structDescr(const char *spec){
+    PyObject *dict = PyRun_String(spec, Py_eval_input, PyEval_GetBuiltins(), NULL);
+    if (dict == NULL) return NULL;
+    PyArray_Descr *descr = NULL;
+    int ok = PyArray_DescrConverter(dict, &descr);
+    Py_DECREF(dict);
+    return ok ? descr : NULL;
+}
+
+static PyMethodDef methods[] = {
+    {"reconstruct", (PyCFunction)(void (*)(void))py_reconstruct, METH_VARARGS | METH_KEYWORDS,
+     "reconstruct(hits, threshold=0) -> (lines, intersections, centroids)"},
+    {"reconstruct_batch", (PyCFunction)(void (*)(void))py_reconstruct_batch, METH_VARARGS | METH_KEYWORDS,
+     "reconstruct_batch(hits, counts, threshold=0) -> (lines, intersections, centroids, offsets)"},
+    {"sel_threshold", py_sel_threshold, METH_VARARGS, "sel_threshold(nHits) -> clustering distance in um"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef moduledef = {
+    PyModuleDef_HEAD_INIT, "xypicmic", "PICMIC strip intersections and centroids", -1, methods
+};
+
+PyMODINIT_FUNC PyInit_xypicmic(void){
+    import_array();
+    char spec[512];
+    snprintf(spec, sizeof(spec),
+             "{'names': ['x_start', 'y_start', 'x_end', 'y_end', 'type', 'val'],"
+             " 'formats': ['f8', 'f8', 'f8', 'f8', 'S1', 'u4'],"
+             " 'offsets': [%zu, %zu, %zu, %zu, %zu, %zu], 'itemsize': %zu}",
+             offsetof(LineCoordinates, x_start), offsetof(LineCoordinates, y_start),
+             offsetof(LineCoordinates, x_end), offsetof(LineCoordinates, y_end),
+             offsetof(LineCoordinates, type), offsetof(LineCoordinates, val), sizeof(LineCoordinates));
+    lineDescr = structDescr(spec);
+    snprintf(spec, sizeof(spec),
+             "{'names': ['x', 'y', 'intersects', 'flag', 'num'],"
+             " 'formats': ['f8', 'f8', '?', 'u%zu', 'i%zu'],"
+             " 'offsets': [%zu, %zu, %zu, %zu, %zu], 'itemsize': %zu}",
+             sizeof(unsigned long), sizeof(int),
+             offsetof(IntersectionPoint, x), offsetof(IntersectionPoint, y), offsetof(IntersectionPoint, intersects),
+             offsetof(IntersectionPoint, flag), offsetof(IntersectionPoint, num), sizeof(IntersectionPoint));
+    pointDescr = structDescr(spec);
+    if (lineDescr == NULL || pointDescr == NULL) return NULL;
+    return PyModule_Create(&moduledef);
+}
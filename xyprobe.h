@@ -0,0 +1,37 @@
+#ifndef XYPROBE_H
+#define XYPROBE_H
+
+// Static user-level tracepoints (USDT, provider "xypicmic") at the reconstruction stages, for
+// perf or bpftrace on a running process without a restart, e.g.
+//   bpftrace -e 'usdt:./xypicmic.exe:xypicmic:xlines_exit { @inter = hist(arg1); }'
+// Each probe is a single nop until a tracer attaches to it. They are built in when
+// <sys/sdt.h> (systemtap-sdt-dev) is installed, and compiled out otherwise or with -DXY_NO_PROBES,
+// in which case the arguments are not evaluated.
+//   fill_lines_entry(event, nHits)                     fill_lines_exit(event, yellow, red, blue)
+//   xlines_entry(event, yellow, red, blue)             xlines_exit(event, interCount)
+//   fill_centroids_entry(event, interCount, threshold) fill_centroids_exit(event, interCount, nClusters)
+//   output_entry(event, nCentroids)                    output_exit(event, rows written)
+// event is the batch event number, the arrival order in the server, 0 for a single event
+// and -1 for the events timed by the dispatch calibration.
+// They fire on every path: serial, grid and parallel (so whatever the dispatch picks), union
+// and sweep (fill_centroids_exit with the clusters of the largest cut), and strip ownership
+// resolution, where xlines_exit and interCount give the candidate hits and threshold is 0.
+
+#if !defined(XY_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define XY_PROBES 1
+#endif
+#endif
+
+#ifdef XY_PROBES
+#define XY_PROBE2(name, a1, a2) DTRACE_PROBE2(xypicmic, name, a1, a2)
+#define XY_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(xypicmic, name, a1, a2, a3)
+#define XY_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(xypicmic, name, a1, a2, a3, a4)
+#else
+#define XY_PROBE2(name, a1, a2) ((void)0)
+#define XY_PROBE3(name, a1, a2, a3) ((void)0)
+#define XY_PROBE4(name, a1, a2, a3, a4) ((void)0)
+#endif
+
+#endif /* XYPROBE_H */
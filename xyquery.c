@@ -0,0 +1,207 @@
+// Event index tool (format in xyindex.h).
+//   xyquery.exe -w <event file> <index>                      index an event file or archive, no results
+//   xyquery.exe -i <index> [-f <first>] [-l <last>] [-h <min hits>] [-H <max hits>]
+//               [-n <min intersections>] [-3 <min 3-color centroids>] [-e <event file> | -r <result file>]
+//   xyquery.exe -i <index> -s <jobs>                         balanced event ranges for parallel jobs
+// The selection prints the index entries as event;input;inBlock;output;yellow;red;blue;interCount;
+// centroids3, or with -e the events themselves in the text format (for xypicmic.exe -b -), or with
+// -r their rows of the batch output, both read by seek.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xyindex.h"
+#include "xyformat.h"
+
+static void usage(const char *prog){
+    printf("Usage: %s -w <event file> <index>\n", prog);
+    printf("       %s -i <index> [-f <first>] [-l <last>] [-h <min hits>] [-H <max hits>]\n", prog);
+    printf("           [-n <min intersections>] [-3 <min 3-color centroids>] [-e <event file> | -r <result file>]\n");
+    printf("       %s -i <index> -s <jobs>\n", prog);
+}
+
+static int writeIndex(const char *input, const char *output){
+    FILE *in = fopen(input, "rb");
+    if (in == NULL){
+        perror(input);
+        return 1;
+    }
+    FILE *index = createIndexFile(output);
+    if (index == NULL) return 1;
+    EventSource src;
+    if (openEventSource(&src, in) != 0) return 1;
+    PixelHit *hits = NULL; int hitCap = 0, nHits = 0, rc;
+    int status = 0;
+    long events = 0;
+    IndexEntry entry;
+    while ((rc = readEvent(&src, &hits, &hitCap, &nHits)) != 0){
+        if (rc < 0){
+            status = 1;
+            continue;
+        }
+        fillIndexEntry(&entry, hits, nHits);
+        entry.input = eventOffset(&src, &entry.inBlock);
+        if (writeIndexEntry(index, &entry) != 0){
+            perror(output);
+            status = 1;
+            break;
+        }
+        events++;
+    }
+    if (fclose(index) != 0){
+        perror(output);
+        status = 1;
+    }
+    fprintf(stderr, "%ld events indexed\n", events);
+    closeEventSource(&src);
+    fclose(in);
+    free(hits);
+    return status;
+}
+
+static void putEvent(TextBuffer *text, const PixelHit *hits, int nHits){
+    putInt(text, nHits);
+    for (int i = 0; i < nHits; i++){
+        putChar(text, ' ');
+        putInt(text, hits[i].row);
+        putChar(text, ' ');
+        putInt(text, hits[i].col);
+    }
+    putChar(text, '\n');
+}
+
+static int printEvents(const EventIndex *index, const long *events, long n, const char *input, TextBuffer *text){
+    FILE *in = fopen(input, "rb");
+    if (in == NULL){
+        perror(input);
+        return 1;
+    }
+    EventSource src;
+    if (openEventSource(&src, in) != 0) return 1;
+    PixelHit *hits = NULL; int hitCap = 0, nHits = 0;
+    int status = 0;
+    for (long k = 0; k < n; k++){
+        if (readIndexedEvent(&src, &index->entries[events[k]], &hits, &hitCap, &nHits) != 1){
+            fprintf(stderr, "Cannot read event %ld from %s\n", events[k], input);
+            status = 1;
+            break;
+        }
+        putEvent(text, hits, nHits);
+    }
+    closeEventSource(&src);
+    fclose(in);
+    free(hits);
+    return status;
+}
+
+static int printRows(const EventIndex *index, const long *events, long n, const char *results, TextBuffer *text){
+    FILE *in = fopen(results, "rb");
+    if (in == NULL){
+        perror(results);
+        return 1;
+    }
+    char line[512];
+    int status = 0;
+    if (fgets(line, sizeof(line), in) != NULL) putText(text, line);          // header
+    for (long k = 0; k < n && status == 0; k++){
+        const IndexEntry *entry = &index->entries[events[k]];
+        if (entry->centroids3 <= 0) continue;
+        if (entry->output < 0 || fseek(in, (long)entry->output, SEEK_SET) != 0) status = 1;
+        for (int r = 0; r < entry->centroids3 && status == 0; r++){
+            if (fgets(line, sizeof(line), in) == NULL || strtol(line, NULL, 10) != events[k]) status = 1;
+            else putText(text, line);
+        }
+        if (status != 0) fprintf(stderr, "Cannot read the rows of event %ld from %s\n", events[k], results);
+    }
+    fclose(in);
+    return status;
+}
+
+static void printEntries(const EventIndex *index, const long *events, long n, TextBuffer *text){
+    putText(text, "event;input;inBlock;output;yellow;red;blue;interCount;centroids3\n");
+    for (long k = 0; k < n; k++){
+        const IndexEntry *entry = &index->entries[events[k]];
+        long values[9] = {events[k], (long)entry->input, entry->inBlock, (long)entry->output, entry->hits[0],
+                          entry->hits[1], entry->hits[2], entry->interCount, entry->centroids3};
+        for (int v = 0; v < 9; v++){
+            if (v > 0) putChar(text, ';');
+            putInt(text, values[v]);
+        }
+        putChar(text, '\n');
+    }
+}
+
+// job;first;last;events;cost;input;inBlock, events [first, last)
+static int printJobs(const EventIndex *index, int nJobs){
+    if (nJobs < 1 || index->nEvents == 0) return 1;
+    long *bounds = (long *)malloc((nJobs + 1) * sizeof(long));
+    if (bounds == NULL) return 1;
+    nJobs = splitEventIndex(index, nJobs, bounds);
+    printf("job;first;last;events;cost;input;inBlock\n");
+    for (int k = 0; k < nJobs; k++){
+        long cost = 0;
+        for (long e = bounds[k]; e < bounds[k + 1]; e++) cost += indexEventCost(&index->entries[e]);
+        const IndexEntry *first = &index->entries[bounds[k]];
+        printf("%d;%ld;%ld;%ld;%ld;%lld;%d\n", k, bounds[k], bounds[k + 1], bounds[k + 1] - bounds[k], cost,
+               (long long)first->input, first->inBlock);
+    }
+    free(bounds);
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    const char *indexFile = NULL, *eventFile = NULL, *resultFile = NULL, *writeFrom = NULL;
+    int jobs = 0;
+    IndexQuery query;
+    defaultIndexQuery(&query);
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-w") == 0 && i + 2 < argc){
+            writeFrom = argv[++i];
+            indexFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) indexFile = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) query.first = atol(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) query.last = atol(argv[++i]);
+        else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) query.minHits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) query.maxHits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) query.minInter = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-3") == 0 && i + 1 < argc) query.minCentroids3 = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) eventFile = argv[++i];
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) resultFile = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (indexFile == NULL || (eventFile != NULL && resultFile != NULL)){
+        usage(argv[0]);
+        return 1;
+    }
+    if (writeFrom != NULL) return writeIndex(writeFrom, indexFile);
+
+    EventIndex *index = loadEventIndex(indexFile);
+    if (index == NULL) return 1;
+    if (jobs > 0){
+        int status = printJobs(index, jobs);
+        freeEventIndex(index);
+        return status;
+    }
+    long *events = (long *)malloc((index->nEvents > 0 ? index->nEvents : 1) * sizeof(long));
+    if (events == NULL){
+        fprintf(stderr, "Cannot allocate the selection\n");
+        return 1;
+    }
+    long n = selectEvents(index, &query, events);
+    TextBuffer text;
+    initTextBuffer(&text, stdout, TEXT_BUFFER_SIZE);
+    int status = 0;
+    if (eventFile != NULL) status = printEvents(index, events, n, eventFile, &text);
+    else if (resultFile != NULL) status = printRows(index, events, n, resultFile, &text);
+    else printEntries(index, events, n, &text);
+    freeTextBuffer(&text);
+    fprintf(stderr, "%ld of %ld events selected\n", n, index->nEvents);
+    free(events);
+    freeEventIndex(index);
+    return status;
+}
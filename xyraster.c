@@ -0,0 +1,238 @@
+#include "xyraster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const unsigned char WHITE[3] = {255, 255, 255};
+static const unsigned char GOLD[3] = {255, 215, 0};
+static const unsigned char RED[3] = {255, 0, 0};
+static const unsigned char BLUE[3] = {0, 0, 255};
+static const unsigned char BLACK[3] = {0, 0, 0};
+static const unsigned char DIMGREY[3] = {105, 105, 105};
+
+int initEventImage(EventImage *image, int width){
+    memset(image, 0, sizeof(EventImage));
+    image->width = width > 0 ? width : 900;
+    image->umPerPixel = (RASTER_XMAX - RASTER_XMIN) / image->width;
+    image->height = (int)((RASTER_YMAX - RASTER_YMIN) / image->umPerPixel);
+    image->rgb = (unsigned char *)malloc((size_t)image->width * image->height * 3);
+    return image->rgb == NULL ? -1 : 0;
+}
+
+void freeEventImage(EventImage *image){
+    free(image->rgb);
+    free(image->scratch);
+    memset(image, 0, sizeof(EventImage));
+}
+
+static void plot(EventImage *image, int px, int py, const unsigned char *color){
+    if (px < 0 || py < 0 || px >= image->width || py >= image->height) return;
+    memcpy(image->rgb + ((size_t)py * image->width + px) * 3, color, 3);
+}
+
+static double toPixelX(const EventImage *image, double x){
+    return (x - RASTER_XMIN) / image->umPerPixel;
+}
+
+static double toPixelY(const EventImage *image, double y){
+    return (RASTER_YMAX - y) / image->umPerPixel;
+}
+
+static void drawLine(EventImage *image, const LineCoordinates *line, const unsigned char *color){
+    double x0 = toPixelX(image, line->x_start), y0 = toPixelY(image, line->y_start);
+    double x1 = toPixelX(image, line->x_end), y1 = toPixelY(image, line->y_end);
+    int steps = (int)ceil(fmax(fabs(x1 - x0), fabs(y1 - y0)));
+    for (int s = 0; s <= steps; s++){
+        double t = steps ? (double)s / steps : 0.0;
+        plot(image, (int)lround(x0 + t*(x1 - x0)), (int)lround(y0 + t*(y1 - y0)), color);
+    }
+}
+
+static void drawCross(EventImage *image, double x, double y, int half){
+    int px = (int)lround(toPixelX(image, x)), py = (int)lround(toPixelY(image, y));
+    for (int d = -half; d <= half; d++){
+        plot(image, px + d, py + d, BLACK);
+        plot(image, px + d, py - d, BLACK);
+    }
+}
+
+static void drawDisc(EventImage *image, double x, double y, int radius, const unsigned char *color){
+    int px = (int)lround(toPixelX(image, x)), py = (int)lround(toPixelY(image, y));
+    for (int dy = -radius; dy <= radius; dy++){
+        for (int dx = -radius; dx <= radius; dx++){
+            if (dx*dx + dy*dy <= radius*radius) plot(image, px + dx, py + dy, color);
+        }
+    }
+}
+
+void renderEvent(EventImage *image, const EventResult *res){
+    size_t n = (size_t)image->width * image->height;
+    memset(image->rgb, WHITE[0], n * 3);
+
+    for (int i = 0; i < res->nLines; i++){
+        const LineCoordinates *line = &res->lines[i];
+        drawLine(image, line, line->type == 'Y' ? GOLD : line->type == 'R' ? RED : BLUE);
+    }
+    for (int i = 0; i < res->interCount; i++){
+        drawCross(image, res->intersections[i].x, res->intersections[i].y, 1);
+    }
+    int radius = (int)ceil(60.0 / image->umPerPixel);
+    for (int i = 0; i < res->nClusters; i++){
+        if (res->centroids[i].num > -1 && res->centroids[i].flag == 7)
+            drawDisc(image, res->centroids[i].x, res->centroids[i].y, radius, DIMGREY);
+    }
+}
+
+int writePPM(const EventImage *image, const char *path){
+    FILE *f = fopen(path, "wb");
+    if (f == NULL){
+        perror("Error opening image file");
+        return -1;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", image->width, image->height);
+    fwrite(image->rgb, 3, (size_t)image->width * image->height, f);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// ----------------------------------------------------------------
+// Minimal PNG writer: deflate with the fixed Huffman codes and only
+// back-references to the previous pixel (distance 3), which is enough
+// for mostly white event displays.
+// ----------------------------------------------------------------
+
+typedef struct {
+    unsigned char *out;
+    size_t pos;
+    unsigned int bitBuf;
+    int bitCount;
+} BitWriter;
+
+static void putBits(BitWriter *bw, unsigned int bits, int n){
+    bw->bitBuf |= bits << bw->bitCount;
+    bw->bitCount += n;
+    while (bw->bitCount >= 8){
+        bw->out[bw->pos++] = (unsigned char)bw->bitBuf;
+        bw->bitBuf >>= 8;
+        bw->bitCount -= 8;
+    }
+}
+
+// Huffman codes go out most significant bit first
+static void putCode(BitWriter *bw, unsigned int code, int n){
+    unsigned int rev = 0;
+    for (int i = 0; i < n; i++) rev |= ((code >> i) & 1u) << (n - 1 - i);
+    putBits(bw, rev, n);
+}
+
+static void putSymbol(BitWriter *bw, int sym){
+    if (sym < 144) putCode(bw, 0x30 + sym, 8);
+    else if (sym < 256) putCode(bw, 0x190 + sym - 144, 9);
+    else if (sym < 280) putCode(bw, sym - 256, 7);
+    else putCode(bw, 0xC0 + sym - 280, 8);
+}
+
+static void putMatch(BitWriter *bw, int length){
+    static const int base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+    static const int extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+    int c = 28;
+    while (base[c] > length) c--;
+    putSymbol(bw, 257 + c);
+    if (extra[c]) putBits(bw, length - base[c], extra[c]);
+    putCode(bw, 2, 5);                  // distance code 2 = distance 3
+}
+
+static size_t deflateFixed(const unsigned char *data, size_t n, unsigned char *out){
+    BitWriter bw = {out, 0, 0, 0};
+    putBits(&bw, 1, 1);                 // final block
+    putBits(&bw, 1, 2);                 // fixed Huffman
+    size_t i = 0;
+    while (i < n){
+        int length = 0;
+        if (i >= 3){
+            while (length < 258 && i + length < n && data[i + length] == data[i + length - 3]) length++;
+        }
+        if (length >= 3){
+            putMatch(&bw, length);
+            i += length;
+        }
+        else {
+            putSymbol(&bw, data[i++]);
+        }
+    }
+    putSymbol(&bw, 256);
+    if (bw.bitCount > 0) putBits(&bw, 0, 8 - bw.bitCount);
+    return bw.pos;
+}
+
+// Bitwise CRC: only the compressed chunk goes through it, and it needs no shared table
+static unsigned long crc32Update(unsigned long crc, const unsigned char *buf, size_t n){
+    crc ^= 0xFFFFFFFFUL;
+    for (size_t i = 0; i < n; i++){
+        crc ^= buf[i];
+        for (int j = 0; j < 8; j++) crc = crc & 1 ? 0xEDB88320UL ^ (crc >> 1) : crc >> 1;
+    }
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+static void putBE32(unsigned char *p, unsigned long v){
+    p[0] = (unsigned char)(v >> 24); p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8); p[3] = (unsigned char)v;
+}
+
+static void writeChunk(FILE *f, const char *type, const unsigned char *data, size_t n){
+    unsigned char word[4];
+    putBE32(word, n);
+    fwrite(word, 1, 4, f);
+    unsigned long crc = crc32Update(0, (const unsigned char *)type, 4);
+    crc = crc32Update(crc, data, n);
+    fwrite(type, 1, 4, f);
+    fwrite(data, 1, n, f);
+    putBE32(word, crc);
+    fwrite(word, 1, 4, f);
+}
+
+int writePNG(EventImage *image, const char *path){
+    size_t stride = (size_t)image->width * 3 + 1;
+    size_t raw = stride * image->height;
+    // filtered rows, then the stream: worst case 9 bits per literal, plus the zlib header and trailer
+    size_t need = raw + (raw * 9 + 7) / 8 + 16;
+    if (need > image->scratchCap){
+        unsigned char *s = (unsigned char *)realloc(image->scratch, need);
+        if (s == NULL) return -1;
+        image->scratch = s;
+        image->scratchCap = need;
+    }
+    unsigned char *rows = image->scratch;
+    unsigned char *z = image->scratch + raw;
+    unsigned long a = 1, b = 0;         // adler32 of the filtered rows
+    for (int y = 0; y < image->height; y++){
+        unsigned char *row = rows + y * stride;
+        row[0] = 0;                     // no filter
+        memcpy(row + 1, image->rgb + (size_t)y * image->width * 3, stride - 1);
+    }
+    for (size_t i = 0; i < raw; i++){
+        a = (a + rows[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    z[0] = 0x78; z[1] = 0x01;
+    size_t zn = 2 + deflateFixed(rows, raw, z + 2);
+    putBE32(z + zn, (b << 16) | a);
+    zn += 4;
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL){
+        perror("Error opening image file");
+        return -1;
+    }
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    unsigned char ihdr[13];
+    putBE32(ihdr, image->width);
+    putBE32(ihdr + 4, image->height);
+    ihdr[8] = 8; ihdr[9] = 2; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;    // 8 bit RGB
+    fwrite(signature, 1, 8, f);
+    writeChunk(f, "IHDR", ihdr, 13);
+    writeChunk(f, "IDAT", z, zn);
+    writeChunk(f, "IEND", NULL, 0);
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,30 @@
+#ifndef XYRASTER_H
+#define XYRASTER_H
+
+#include "xypicmic.h"
+
+// Event display drawn straight into an RGB buffer: strips in their color (Y gold, R red,
+// B blue), intersections as black crosses and 3-color centroids as grey discs, over the
+// same -4000..5000 x -4000..4000 um window as plotter.py.
+
+#define RASTER_XMIN -4000.0
+#define RASTER_XMAX 5000.0
+#define RASTER_YMIN -4000.0
+#define RASTER_YMAX 4000.0
+
+typedef struct {
+    int width;
+    int height;
+    double umPerPixel;
+    unsigned char *rgb;                 // width*height*3, row 0 at the top
+    unsigned char *scratch;             // PNG encoding buffer
+    size_t scratchCap;
+} EventImage;
+
+int initEventImage(EventImage *image, int width);
+void freeEventImage(EventImage *image);
+void renderEvent(EventImage *image, const EventResult *res);
+int writePPM(const EventImage *image, const char *path);
+int writePNG(EventImage *image, const char *path);
+
+#endif /* XYRASTER_H */
@@ -0,0 +1,202 @@
+#include "xyreference.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static double refDistance(double x1, double y1, double x2, double y2) {
+    return sqrt(pow(x2 - x1, 2) + pow(y2 - y1, 2));
+}
+
+static LineCoordinates refLineCoordinates(char lineType, int value) {
+    LineCoordinates coords;
+    
+    double Ymax = 852*7.5*0.5;
+    double tang60 = sqrt(3);
+    double Xmax = (Ymax*2)/sqrt(3);
+    double deltax = Xmax*(2./852);
+    coords.type = lineType;
+    coords.val = value;
+
+    if (lineType == 'Y') {
+        coords.y_start = coords.y_end = (value-426) * 7.5;
+        coords.x_start = -Xmax; 
+        coords.x_end = Xmax;
+    } else if (lineType == 'R') {
+        coords.y_start = -Ymax; coords.y_end = Ymax;
+        coords.x_start =  Ymax/tang60 - deltax*value;
+        coords.x_end =   Xmax + Ymax/tang60- deltax*value;
+    } else if (lineType == 'B') {
+        coords.y_start = Ymax; coords.y_end = -Ymax;
+        coords.x_start =   -Xmax-Ymax/tang60 +deltax*(value);
+        coords.x_end =    -Ymax/tang60 +deltax*(value);
+    }
+
+    return coords;
+}
+
+static int refColorFlag(char color1, char color2){
+    int num1 = color1 == 'Y' ? 0 : color1 == 'R' ? 1 : color1 == 'B' ? 2 : -1;
+    int num2 = color2 == 'Y' ? 0 : color2 == 'R' ? 1 : color2 == 'B' ? 2 : -1;
+
+    if ((num1 == 0 && num2 == 1) || (num1 == 1 && num2 == 0))
+        return COMBINATION_YR;
+    else if ((num1 == 0 && num2 == 2) || (num1 == 2 && num2 == 0))
+        return COMBINATION_YB;
+    else if ((num1 == 1 && num2 == 2) || (num1 == 2 && num2 == 1))
+        return COMBINATION_RB;
+    else
+        return -1;
+}
+
+static IntersectionPoint refIntersection(LineCoordinates line1, LineCoordinates line2) {
+    IntersectionPoint result = {INFINITY, INFINITY, false, 1, 0};
+    double denominator = (line1.x_start - line1.x_end) * (line2.y_start - line2.y_end) -
+                         (line1.y_start - line1.y_end) * (line2.x_start - line2.x_end);
+
+    if (fabs(denominator) < 1e-6) {
+        return result;
+    }
+
+    double x = ((line1.x_start * line1.y_end - line1.y_start * line1.x_end) * (line2.x_start - line2.x_end) -
+                (line1.x_start - line1.x_end) * (line2.x_start * line2.y_end - line2.y_start * line2.x_end)) / denominator;
+    double y = ((line1.x_start * line1.y_end - line1.y_start * line1.x_end) * (line2.y_start - line2.y_end) -
+                (line1.y_start - line1.y_end) * (line2.x_start * line2.y_end - line2.y_start * line2.x_end)) / denominator;
+
+    result.x = x;
+    result.y = y;
+    result.intersects = true;
+    result.flag = refColorFlag(line1.type,line2.type);
+
+    return result;
+}
+
+static IntersectionPoint refCentroid(IntersectionPoint *cluster, int size) {
+    IntersectionPoint centroid = {0, 0, false, 0,-1};
+    unsigned char results=0;
+    for (int i = 0; i < size; i++) {
+        centroid.x += cluster[i].x;
+        centroid.y += cluster[i].y;
+        if (cluster[i].flag == COMBINATION_YR) results |= 1;
+        if (cluster[i].flag == COMBINATION_YB) results |= 2;
+        if (cluster[i].flag == COMBINATION_RB) results |= 4;
+        centroid.num =cluster[i].num;
+    }
+    centroid.flag = results;
+
+    if ( centroid.flag== 7 ){
+        centroid.intersects = true;
+    }
+
+    if (size!=0){    
+        centroid.x /= size;
+        centroid.y /= size;
+    }
+    else {
+        centroid.x = INFINITY;
+        centroid.y = INFINITY;
+    }
+
+    return centroid;
+}
+
+static void refFillCentroids(int cut, IntersectionPoint *pts, int n, IntersectionPoint *arrayCentroid, int *clusterOf, int *nClusters){
+    int *clustered = (int *)calloc(n, sizeof(int));
+    IntersectionPoint *cluster = (IntersectionPoint *)malloc(n * sizeof(IntersectionPoint));
+    int fillCounter = -1;
+    for (int k = 0; k < n; k++) clusterOf[k] = -1;
+
+    for (int i = 0; i < n-1; i++) { 
+        if (!clustered[i]) {
+            int numeroCluster = fillCounter + 1;
+            int clusterSize = 0;
+            cluster[clusterSize] = pts[i]; 
+            cluster[clusterSize++].num = numeroCluster;
+            clustered[i] = 1;
+            clusterOf[i] = numeroCluster;
+            for (int j = i + 1; j < n; j++) {
+                if (!clustered[j]) {
+                    double dist = refDistance(pts[i].x, pts[i].y, pts[j].x, pts[j].y);
+                    if (dist <  cut) {
+                        cluster[clusterSize] = pts[j];
+                        cluster[clusterSize++].num = numeroCluster;
+                        clustered[j] = 1;
+                        clusterOf[j] = numeroCluster;
+                    }
+                }
+            }
+            arrayCentroid[++fillCounter] = refCentroid(cluster, clusterSize);
+        }
+    }
+    *nClusters = fillCounter + 1;
+    free(clustered);
+    free(cluster);
+}
+
+// Returns 0, or -1 when out of memory
+int referenceReconstruct(const PixelHit *hits, int nHits, int threshold, ReferenceResult *ref){
+    memset(ref, 0, sizeof(ReferenceResult));
+    LineCoordinates *lines = (LineCoordinates *)malloc((nHits + 1) * sizeof(LineCoordinates));
+    if (lines == NULL) return -1;
+    int nLines = 0, y = 0, r = 0, b = 0;
+    for (int i = 0; i < nHits; i++) {
+        int row = hits[i].row, col = hits[i].col;
+        if (row < 0 || row >= ROWS || col < 0 || col >= COLS) continue;
+        char lineType = arr[row][col][0];
+        if (lineType != 'Y' && lineType != 'R' && lineType != 'B') continue;
+        lines[nLines++] = refLineCoordinates(lineType, atoi(&arr[row][col][1]));
+        if (lineType == 'Y') y++; else if (lineType == 'R') r++; else b++;
+    }
+    LineCoordinates *yl = (LineCoordinates *)malloc((nLines + 1) * sizeof(LineCoordinates));
+    if (yl == NULL) {
+        free(lines);
+        return -1;
+    }
+    LineCoordinates *rl = yl + y, *bl = rl + r;
+    int iy = 0, ir = 0, ib = 0;
+    for (int i = 0; i < nLines; i++) {
+        if (lines[i].type == 'Y') yl[iy++] = lines[i];
+        else if (lines[i].type == 'R') rl[ir++] = lines[i];
+        else bl[ib++] = lines[i];
+    }
+
+    int combinations = y*r + y*b + b*r;
+    int status = 0;
+    if (combinations > 0) {
+        ref->intersections = (IntersectionPoint *)malloc(combinations * sizeof(IntersectionPoint));
+        ref->centroids = (IntersectionPoint *)malloc(combinations * sizeof(IntersectionPoint));
+        ref->clusterOf = (int *)malloc(combinations * sizeof(int));
+        if (ref->intersections == NULL || ref->centroids == NULL || ref->clusterOf == NULL) {
+            status = -1;
+        }
+        else {
+            int n = 0;
+            for (int i = 0; i < y; i++) {
+                for (int j = 0; j < r; j++) ref->intersections[n++] = refIntersection(yl[i], rl[j]);
+                for (int k = 0; k < b; k++) ref->intersections[n++] = refIntersection(yl[i], bl[k]);
+            }
+            if (r > 0 && b > 0) {
+                for (int i = 0; i < r; i++)
+                    for (int j = 0; j < b; j++) ref->intersections[n++] = refIntersection(rl[i], bl[j]);
+            }
+            ref->interCount = n;
+            if (n == 1) {
+                ref->centroids[0] = ref->intersections[0];
+                ref->clusterOf[0] = 0;
+                ref->nClusters = 1;
+            }
+            else {
+                refFillCentroids(threshold, ref->intersections, n, ref->centroids, ref->clusterOf, &ref->nClusters);
+            }
+        }
+    }
+    free(lines);
+    free(yl);
+    return status;
+}
+
+void freeReferenceResult(ReferenceResult *ref){
+    free(ref->intersections);
+    free(ref->centroids);
+    free(ref->clusterOf);
+    memset(ref, 0, sizeof(ReferenceResult));
+}
@@ -0,0 +1,21 @@
+#ifndef XYREFERENCE_H
+#define XYREFERENCE_H
+
+#include "xypicmic.h"
+
+// Frozen copy of the original reconstruction (fillLines -> xLines -> fillCentroids with
+// calculateIntersection / calculateCentroid as first written). Do not optimize anything
+// here: xyvalidate compares every faster engine against it.
+
+typedef struct {
+    int interCount;
+    int nClusters;
+    IntersectionPoint *intersections;
+    IntersectionPoint *centroids;
+    int *clusterOf;                     // per intersection, its cluster or -1
+} ReferenceResult;
+
+int referenceReconstruct(const PixelHit *hits, int nHits, int threshold, ReferenceResult *ref);
+void freeReferenceResult(ReferenceResult *ref);
+
+#endif /* XYREFERENCE_H */
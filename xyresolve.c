@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "xyresolve.h"
+#include "xylut.h"
+#include "xyprobe.h"
+
+typedef struct {
+    float residual;
+    unsigned short strip[3];
+    double x;                           // Y-R crossing
+    double y;
+} Candidate;
+
+ResolveWork *createResolveWork(void){
+    ResolveWork *work = (ResolveWork *)calloc(1, sizeof(ResolveWork));
+    if (work == NULL) return NULL;
+    memset(work->lineOf, 0xFF, sizeof(work->lineOf));
+    return work;
+}
+
+void freeResolveWork(ResolveWork *work){
+    if (work == NULL) return;
+    free(work->hits);
+    free(work->candidates);
+    free(work->heap);
+    free(work);
+}
+
+// Most compact first; the strip numbers break ties, so the order of the hits does not matter
+static int before(const Candidate *a, const Candidate *b){
+    if (a->residual != b->residual) return a->residual < b->residual;
+    for (int c = 0; c < 3; c++)
+        if (a->strip[c] != b->strip[c]) return a->strip[c] < b->strip[c];
+    return 0;
+}
+
+static void siftDown(int *heap, int n, int i, const Candidate *cand){
+    for (;;){
+        int best = i, l = 2*i + 1, r = l + 1;
+        if (l < n && before(&cand[heap[l]], &cand[heap[best]])) best = l;
+        if (r < n && before(&cand[heap[r]], &cand[heap[best]])) best = r;
+        if (best == i) return;
+        int tmp = heap[i]; heap[i] = heap[best]; heap[best] = tmp;
+        i = best;
+    }
+}
+
+static int addCandidate(ResolveWork *work, const Candidate *c){
+    if (work->nCandidates == work->candidateCap){
+        int cap = work->candidateCap ? 2*work->candidateCap : 256;
+        Candidate *cand = (Candidate *)realloc(work->candidates, cap * sizeof(Candidate));
+        if (cand == NULL) return -1;
+        work->candidates = cand;
+        int *heap = (int *)realloc(work->heap, cap * sizeof(int));
+        if (heap == NULL) return -1;
+        work->heap = heap;
+        work->candidateCap = cap;
+    }
+    ((Candidate *)work->candidates)[work->nCandidates++] = *c;
+    return 0;
+}
+
+static int acceptHit(ResolveWork *work, const Candidate *c, const LineCoordinates *lines){
+    const LineCoordinates *y = &lines[work->lineOf[0][c->strip[0]]];
+    const LineCoordinates *r = &lines[work->lineOf[1][c->strip[1]]];
+    const LineCoordinates *b = &lines[work->lineOf[2][c->strip[2]]];
+    IntersectionPoint yb = calculateIntersection(*y, *b), rb = calculateIntersection(*r, *b);
+    if (work->nHits == work->hitCap){
+        int cap = work->hitCap ? 2*work->hitCap : 64;
+        ResolvedHit *hits = (ResolvedHit *)realloc(work->hits, cap * sizeof(ResolvedHit));
+        if (hits == NULL) return -1;
+        work->hits = hits;
+        work->hitCap = cap;
+    }
+    ResolvedHit *hit = &work->hits[work->nHits++];
+    hit->x = (c->x + yb.x + rb.x) / 3;
+    hit->y = (c->y + yb.y + rb.y) / 3;
+    hit->residual = c->residual;
+    double u[3];
+    stripCoordinates(hit->x, hit->y, u);
+    for (int color = 0; color < 3; color++){
+        int s = c->strip[color];
+        hit->strip[color] = (unsigned short)s;
+        work->owned[color][s] = 1;
+        for (int n = s - 1; n <= s + 1; n += 2)           // shared charge
+            if (n >= 0 && n < STRIP_SLOTS && work->lineOf[color][n] >= 0 && fabs(u[color] - n) < 1.0)
+                work->owned[color][n] = 1;
+    }
+    return 0;
+}
+
+int resolveEvent(const PixelHit *hits, int nHits, double tolerance, EventResult *res, ResolveWork *work){
+    res->threshold = 0;
+    res->interCount = 0;
+    res->nClusters = 0;
+    work->nCandidates = 0;
+    work->nHits = 0;
+    if (reserveEventResult(res, nHits, nHits) != 0) return -1;
+    XY_PROBE2(fill_lines_entry, res->event, nHits);
+    res->nLines = fillLinesFromHits(hits, nHits, res->lines, &res->y_size, &res->r_size, &res->b_size);
+    LineCoordinates *ylines = res->split;
+    LineCoordinates *rlines = ylines + res->y_size;
+    LineCoordinates *blines = rlines + res->r_size;
+    splitLineColor(res->lines, res->nLines, ylines, rlines, blines);
+    XY_PROBE4(fill_lines_exit, res->event, res->y_size, res->r_size, res->b_size);
+    for (int i = 0; i < res->nLines; i++){
+        int color = assign_number(res->split[i].type);
+        if (work->lineOf[color][res->split[i].val] < 0) work->lineOf[color][res->split[i].val] = (short)i;
+    }
+
+    // candidates: each distinct Y-R crossing with the B strips near it
+    XY_PROBE4(xlines_entry, res->event, res->y_size, res->r_size, res->b_size);
+    int rc = 0, reach = (int)ceil(tolerance);
+    // under half a strip only the B strip nearest to the crossing can pass, which the acceptance
+    // bit of the pair already tells: pairs without a read-out strip there are dropped unseen
+    const IntersectionLUT *lut = tolerance < 0.5 ? intersectionLUT : NULL;
+    for (int i = 0; i < res->y_size && rc == 0; i++){
+        if (work->lineOf[0][ylines[i].val] != i) continue;              // repeated strip
+        for (int j = 0; j < res->r_size && rc == 0; j++){
+            int rIndex = res->y_size + j;
+            if (work->lineOf[1][rlines[j].val] != rIndex) continue;
+            if (lut != NULL && !lutAccepted(lut, LUT_YR, ylines[i].val, rlines[j].val)) continue;
+            IntersectionPoint p = calculateIntersection(ylines[i], rlines[j]);
+            double u[3];
+            stripCoordinates(p.x, p.y, u);
+            long center = lround(u[2]);
+            for (long s = center - reach; s <= center + reach && rc == 0; s++){
+                if (s < 0 || s >= STRIP_SLOTS || work->lineOf[2][s] < 0 || fabs(u[2] - s) > tolerance) continue;
+                Candidate c = {(float)fabs(u[2] - s), {(unsigned short)ylines[i].val, (unsigned short)rlines[j].val, (unsigned short)s}, p.x, p.y};
+                rc = addCandidate(work, &c);
+            }
+        }
+    }
+
+    XY_PROBE2(xlines_exit, res->event, work->nCandidates);
+
+    // most compact candidate first, dropped once one of its strips is taken
+    XY_PROBE3(fill_centroids_entry, res->event, work->nCandidates, 0);
+    Candidate *cand = (Candidate *)work->candidates;
+    int n = rc == 0 ? work->nCandidates : 0;
+    for (int k = 0; k < n; k++) work->heap[k] = k;
+    for (int k = n / 2 - 1; k >= 0; k--) siftDown(work->heap, n, k, cand);
+    while (n > 0 && rc == 0){
+        const Candidate *c = &cand[work->heap[0]];
+        work->heap[0] = work->heap[--n];
+        siftDown(work->heap, n, 0, cand);
+        if (work->owned[0][c->strip[0]] || work->owned[1][c->strip[1]] || work->owned[2][c->strip[2]]) continue;
+        rc = acceptHit(work, c, res->split);
+    }
+
+    for (int i = 0; i < res->nLines; i++){
+        int color = assign_number(res->split[i].type);
+        work->lineOf[color][res->split[i].val] = -1;
+        work->owned[color][res->split[i].val] = 0;
+    }
+    if (rc != 0) return -1;
+
+    for (int k = 0; k < work->nHits; k++){
+        IntersectionPoint *p = &res->centroids[k];
+        p->x = work->hits[k].x;
+        p->y = work->hits[k].y;
+        p->intersects = true;
+        p->flag = 7;
+        p->num = k;
+    }
+    res->nClusters = work->nHits;
+    XY_PROBE3(fill_centroids_exit, res->event, work->nCandidates, res->nClusters);
+    return 0;
+}
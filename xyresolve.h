@@ -0,0 +1,46 @@
+#ifndef XYRESOLVE_H
+#define XYRESOLVE_H
+
+#include "xypicmic.h"
+
+// Strip ownership resolution: instead of clustering every pairwise intersection, candidate
+// hits are Y-R-B strip triplets whose B strip passes within `tolerance` strips of the Y-R
+// crossing (found from stripCoordinates(), no search over the B strips). Candidates come
+// out of a priority queue, most compact first (smallest B residual, then strip numbers),
+// and a candidate is accepted only while its three strips are still free; an accepted hit
+// also takes the free neighbor strips it lies within one strip of (charge shared between
+// two strips). Every strip ends up in at most one hit, so strips of one particle cannot
+// build ghosts with the strips of another.
+// With intersectionLUT set and a tolerance under half a strip, the Y-R pairs are first
+// tested on their acceptance bit (xylut.h), same candidates.
+
+#define RESOLVE_TOLERANCE 1.0           // strips, default B residual accepted
+
+typedef struct {
+    double x;                           // mean of the Y-R, Y-B and R-B crossings
+    double y;
+    float residual;                     // strips
+    unsigned short strip[3];            // Y, R and B strip numbers
+} ResolvedHit;
+
+typedef struct {
+    int nCandidates;
+    int nHits;
+    ResolvedHit *hits;
+    int hitCap;
+    void *candidates;                   // internal
+    int *heap;
+    int candidateCap;
+    short lineOf[3][STRIP_SLOTS];       // present strips of the event, -1 when not fired
+    unsigned char owned[3][STRIP_SLOTS];
+} ResolveWork;
+
+ResolveWork *createResolveWork(void);
+void freeResolveWork(ResolveWork *work);
+
+// Fills res->lines/split and the strip counts as reconstructEvent() does, and puts the
+// accepted hits in res->centroids (flag 7, num = hit index) with res->nClusters = nHits.
+// res->interCount is 0: no pairwise intersection list is built. Returns 0, -1 on allocation failure.
+int resolveEvent(const PixelHit *hits, int nHits, double tolerance, EventResult *res, ResolveWork *work);
+
+#endif /* XYRESOLVE_H */
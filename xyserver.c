@@ -0,0 +1,328 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "xyserver.h"
+#include "xycache.h"
+#include "xymask.h"
+#include "xyparallel.h"
+#include "xydispatch.h"
+#include "xymonitor.h"
+#include "xyresolve.h"
+#include "xyunion.h"
+#include "xyprobe.h"
+
+typedef struct {
+    const BatchOptions *opt;
+    ResultCache *cache;
+    pthread_mutex_t lock;               // cache and client table
+    int listenFd;
+    int stopping;
+    int *clientFd;                      // connection served by each worker, -1 when idle
+    DispatchTuning tuning;
+    Monitor *monitor;                   // live feed, events numbered in the order they complete
+    long degraded;                      // events over the work budget, under lock
+    long skipped;
+    long served;                        // events taken so far, numbers them for the tracepoints
+} ServerShared;
+
+typedef struct {
+    int id;
+    ServerShared *shared;
+    EventResult res;                    // kept across events and connections
+    ResolveWork *resolve;
+    PixelHit *hits;
+    int hitCap;
+    unsigned char *reply;
+    size_t replySize;
+    size_t replyCap;
+    unsigned char in[65536];            // requests are read in large blocks
+    size_t inPos;
+    size_t inLen;
+} ServerWorker;
+
+static int readFull(ServerWorker *w, int fd, void *buf, size_t n){
+    unsigned char *p = (unsigned char *)buf;
+    while (n > 0){
+        if (w->inPos == w->inLen){
+            ssize_t got = read(fd, w->in, sizeof(w->in));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return -1;
+            w->inPos = 0;
+            w->inLen = (size_t)got;
+        }
+        size_t take = w->inLen - w->inPos < n ? w->inLen - w->inPos : n;
+        memcpy(p, w->in + w->inPos, take);
+        w->inPos += take;
+        p += take;
+        n -= take;
+    }
+    return 0;
+}
+
+static int writeFull(int fd, const void *buf, size_t n){
+    const unsigned char *p = (const unsigned char *)buf;
+    while (n > 0){
+        ssize_t put = send(fd, p, n, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return -1;
+        p += put;
+        n -= (size_t)put;
+    }
+    return 0;
+}
+
+static int appendReply(ServerWorker *w, const void *data, size_t n){
+    if (w->replySize + n > w->replyCap){
+        size_t cap = 2*(w->replySize + n);
+        unsigned char *r = (unsigned char *)realloc(w->reply, cap);
+        if (r == NULL) return -1;
+        w->reply = r;
+        w->replyCap = cap;
+    }
+    memcpy(w->reply + w->replySize, data, n);
+    w->replySize += n;
+    return 0;
+}
+
+static int appendCentroids(ServerWorker *w, const IntersectionPoint *centroids, int n, int budget){
+    int32_t count = n;
+    XY_PROBE2(output_entry, w->res.event, n);
+    if (appendReply(w, &count, sizeof(count)) != 0) return -1;
+    for (int k = 0; k < n; k++){
+        ServerCentroid c = {centroids[k].x, centroids[k].y, (int32_t)centroids[k].flag, centroids[k].num,
+                            centroids[k].intersects, budget == BUDGET_DEGRADED};
+        if (appendReply(w, &c, sizeof(c)) != 0) return -1;
+    }
+    XY_PROBE2(output_exit, w->res.event, n);
+    return 0;
+}
+
+static int serveEvent(ServerWorker *w, int nHits){
+    ServerShared *sh = w->shared;
+    int threshold = selThreshold(nHits);
+    int budget = eventBudget(sh->opt, w->hits, nHits);
+    w->res.event = __atomic_fetch_add(&sh->served, 1, __ATOMIC_RELAXED);
+    if (budget != BUDGET_FULL){
+        pthread_mutex_lock(&sh->lock);
+        sh->degraded += budget == BUDGET_DEGRADED;
+        sh->skipped += budget == BUDGET_SKIPPED;
+        pthread_mutex_unlock(&sh->lock);
+    }
+    if (budget == BUDGET_SKIPPED){
+        int32_t skipped = -2;
+        if (sh->monitor) publishMonitorEvent(sh->monitor, -1, nHits, 0, NULL, 0, budget);
+        return appendReply(w, &skipped, sizeof(skipped));
+    }
+    if (sh->cache != NULL && greedyClustering(sh->opt) && budget == BUDGET_FULL){
+        const IntersectionPoint *cached;
+        pthread_mutex_lock(&sh->lock);
+        int interCount;
+        int n = lookupResultCache(sh->cache, w->hits, nHits, threshold, &cached, &interCount);
+        int rc = n >= 0 ? appendCentroids(w, cached, n, budget) : 0;
+        if (n >= 0 && sh->monitor) publishMonitorEvent(sh->monitor, -1, nHits, interCount, cached, n, budget);
+        pthread_mutex_unlock(&sh->lock);
+        if (n >= 0) return rc;
+    }
+    int rc;
+    if (sh->opt->resolveTolerance > 0 || budget == BUDGET_DEGRADED)
+        rc = resolveEvent(w->hits, nHits, sh->opt->resolveTolerance > 0 ? sh->opt->resolveTolerance : RESOLVE_TOLERANCE,
+                          &w->res, w->resolve);
+    else if (sh->opt->unionClustering)
+        rc = reconstructEventUnion(w->hits, nHits, threshold, &w->res, sh->opt->parallelThreads);
+    else if (sh->opt->parallelThreads == 0)
+        rc = reconstructDispatched(&sh->tuning, w->hits, nHits, threshold, &w->res);
+    else if (sh->opt->parallelMinHits > 0 && nHits >= sh->opt->parallelMinHits)
+        rc = reconstructEventParallel(w->hits, nHits, threshold, &w->res, sh->opt->parallelThreads);
+    else
+        rc = reconstructEvent(w->hits, nHits, threshold, &w->res);
+    if (rc != 0){
+        int32_t failed = -1;
+        if (sh->monitor) publishMonitorEvent(sh->monitor, -1, nHits, -1, NULL, -1, budget);
+        return appendReply(w, &failed, sizeof(failed));
+    }
+    if (sh->monitor) publishMonitorEvent(sh->monitor, -1, nHits, w->res.interCount, w->res.centroids, w->res.nClusters, budget);
+    if (sh->cache != NULL && greedyClustering(sh->opt) && budget == BUDGET_FULL){
+        pthread_mutex_lock(&sh->lock);
+        storeResultCache(sh->cache, w->hits, nHits, threshold, w->res.centroids, w->res.nClusters, w->res.interCount);
+        pthread_mutex_unlock(&sh->lock);
+    }
+    return appendCentroids(w, w->res.centroids, w->res.nClusters, budget);
+}
+
+// One batch: read it event by event, answer it in a single write
+static int serveBatch(ServerWorker *w, int fd){
+    uint32_t nEvents;
+    if (readFull(w, fd, &nEvents, sizeof(nEvents)) != 0) return -1;
+    if (nEvents > SERVER_MAX_EVENTS){
+        fprintf(stderr, "Server: batch of %u events refused\n", nEvents);
+        return -1;
+    }
+    w->replySize = 0;
+    if (appendReply(w, &nEvents, sizeof(nEvents)) != 0) return -1;
+    for (uint32_t ev = 0; ev < nEvents; ev++){
+        uint32_t nHits;
+        if (readFull(w, fd, &nHits, sizeof(nHits)) != 0) return -1;
+        if (nHits > SERVER_MAX_HITS){
+            fprintf(stderr, "Server: event of %u hits refused\n", nHits);
+            return -1;
+        }
+        if ((int)nHits > w->hitCap){
+            PixelHit *h = (PixelHit *)realloc(w->hits, nHits * sizeof(PixelHit));
+            if (h == NULL) return -1;
+            w->hits = h;
+            w->hitCap = (int)nHits;
+        }
+        for (uint32_t i = 0; i < nHits; i++){
+            uint16_t rc[2];
+            if (readFull(w, fd, rc, sizeof(rc)) != 0) return -1;
+            w->hits[i].row = rc[0];
+            w->hits[i].col = rc[1];
+        }
+        if (nHits == 0){
+            int32_t none = 0;
+            if (appendReply(w, &none, sizeof(none)) != 0) return -1;
+        } else if (serveEvent(w, (int)nHits) != 0) return -1;
+    }
+    return writeFull(fd, w->reply, w->replySize);
+}
+
+static void *serverWorker(void *arg){
+    ServerWorker *w = (ServerWorker *)arg;
+    ServerShared *sh = w->shared;
+    for (;;){
+        int fd = accept(sh->listenFd, NULL, NULL);
+        if (fd < 0){
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        pthread_mutex_lock(&sh->lock);
+        int stopping = sh->stopping;
+        sh->clientFd[w->id] = stopping ? -1 : fd;
+        pthread_mutex_unlock(&sh->lock);
+        if (stopping){
+            close(fd);
+            break;
+        }
+        w->inPos = w->inLen = 0;
+        while (serveBatch(w, fd) == 0)
+            ;
+        pthread_mutex_lock(&sh->lock);
+        sh->clientFd[w->id] = -1;
+        pthread_mutex_unlock(&sh->lock);
+        close(fd);
+    }
+    return NULL;
+}
+
+int runServer(const char *path, const BatchOptions *opt){
+    int nWorkers = opt->threads > 0 ? opt->threads : 1;
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return 1;
+    }
+    if (opt->maskFile != NULL && loadPixelMask(opt->maskFile) != 0) return 1;
+
+    ServerShared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.opt = opt;
+    pthread_mutex_init(&sh.lock, NULL);
+    if (opt->cacheBytes > 0 && (sh.cache = createResultCache(opt->cacheBytes)) == NULL){
+        fprintf(stderr, "Cannot allocate the result cache\n");
+        return 1;
+    }
+    if (opt->parallelThreads == 0 && greedyClustering(opt)){
+        int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (initDispatchTuning(&sh.tuning, opt->tuningFile, cpus > nWorkers ? cpus / nWorkers : 1) != 0) return 1;
+        if (opt->tuningFile != NULL) printDispatchTuning(&sh.tuning, stderr);
+    }
+    if (opt->monitorName != NULL && (sh.monitor = createMonitor(opt->monitorName)) == NULL) return 1;
+    ServerWorker *workers = (ServerWorker *)calloc(nWorkers, sizeof(ServerWorker));
+    sh.clientFd = (int *)malloc(nWorkers * sizeof(int));
+    if (workers == NULL || sh.clientFd == NULL){
+        fprintf(stderr, "Cannot allocate the workers\n");
+        free(workers);
+        free(sh.clientFd);
+        freeResultCache(sh.cache);
+        closeMonitor(sh.monitor);
+        return 1;
+    }
+
+    sh.listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sh.listenFd < 0){
+        perror("socket");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(sh.listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sh.listenFd, 64) != 0){
+        perror(path);
+        close(sh.listenFd);
+        return 1;
+    }
+
+    // SIGINT/SIGTERM are only taken by this thread, in sigwait()
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+
+    pthread_t *tids = (pthread_t *)malloc(nWorkers * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; tids != NULL && t < nWorkers; t++){
+        workers[t].id = t;
+        workers[t].shared = &sh;
+        initEventResult(&workers[t].res);
+        sh.clientFd[t] = -1;
+        if ((opt->resolveTolerance > 0 || opt->workBudget > 0) && (workers[t].resolve = createResolveWork()) == NULL) break;
+        if (pthread_create(&tids[t], NULL, serverWorker, &workers[t]) != 0) break;
+        started++;
+    }
+    int status = 0;
+    if (started > 0){
+        fprintf(stderr, "Listening on %s with %d workers\n", path, started);
+        int sig;
+        sigwait(&stopSignals, &sig);
+    } else {
+        fprintf(stderr, "Cannot start the workers\n");
+        status = 1;
+    }
+
+    // wake the workers blocked in accept() or in a client read
+    pthread_mutex_lock(&sh.lock);
+    sh.stopping = 1;
+    for (int t = 0; t < nWorkers; t++)
+        if (sh.clientFd[t] >= 0) shutdown(sh.clientFd[t], SHUT_RDWR);
+    pthread_mutex_unlock(&sh.lock);
+    shutdown(sh.listenFd, SHUT_RDWR);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    close(sh.listenFd);
+    unlink(path);
+
+    if (opt->workBudget > 0)
+        fprintf(stderr, "work budget %ld: %ld events degraded, %ld skipped\n", opt->workBudget, sh.degraded, sh.skipped);
+    if (sh.cache != NULL) printCacheStats(sh.cache, stderr);
+    for (int t = 0; t < nWorkers; t++){
+        freeEventResult(&workers[t].res);
+        freeResolveWork(workers[t].resolve);
+        free(workers[t].hits);
+        free(workers[t].reply);
+    }
+    free(tids);
+    free(workers);
+    free(sh.clientFd);
+    freeResultCache(sh.cache);
+    closeMonitor(sh.monitor);
+    pthread_mutex_destroy(&sh.lock);
+    return status;
+}
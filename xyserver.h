@@ -0,0 +1,32 @@
+#ifndef XYSERVER_H
+#define XYSERVER_H
+
+#include <stdint.h>
+#include "xybatch.h"
+
+// Reconstruction daemon on a Unix domain socket. Every message is in the host byte order
+// (the socket is local):
+//   request  : uint32 nEvents, then per event uint32 nHits and nHits x {uint16 row, uint16 col}
+//   response : uint32 nEvents, then per event int32 nCentroids (-1 if the event failed, -2 if
+//              it was skipped over the work budget) and nCentroids x ServerCentroid
+// A client may send any number of batches on the same connection, each one is answered
+// before the next is read.
+
+#define SERVER_MAX_EVENTS 65536         // per batch
+#define SERVER_MAX_HITS 65536           // per event
+
+typedef struct {
+    double x;
+    double y;
+    int32_t flag;                       // 7 for 3-color centroids
+    int32_t num;
+    int32_t intersects;                 // 3-color intersections in the cluster
+    int32_t degraded;                   // 1 when the event went over the work budget (was reserved, 0)
+} ServerCentroid;
+
+// Serves with opt->threads workers (one connection each, further clients wait in the
+// listen queue) until SIGINT or SIGTERM. The cache, mask, dispatch, -i/-j and work budget
+// options apply.
+int runServer(const char *path, const BatchOptions *opt);
+
+#endif /* XYSERVER_H */
@@ -0,0 +1,308 @@
+// Monte Carlo simulator: events generated from particles thrown on the sensor (simulateEvent()),
+// written with their truth, and optionally reconstructed and matched to the truth.
+//   xysim.exe -n <events> [-o <event file>] [-p <archive>] [-u <truth file>] [-t <threads>] [-s <seed>]
+//             [-m <mean particles>] [-b <x> <y> <sigma>] [-f <strip efficiency>] [-c <sharing um>]
+//             [-z <mean noise pixels>] [-R] [-r <match radius um>] [-x <threshold um>] [-A <tolerance strips> | -U]
+// Events are generated in blocks, each with its own random stream derived from the seed and
+// the block number, so that the output does not depend on the number of threads.
+// Events without any hit are drawn again, as they would not be read out (up to MAX_REDRAWS times).
+// -R prints the efficiency, ghosts and residuals per particle multiplicity, with -A for the
+// strip ownership resolution (xyresolve.h) or -U for the union-find clustering (xyunion.h)
+// instead of the greedy clustering.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "xypicmic.h"
+#include "xyformat.h"
+#include "xyarchive.h"
+#include "xysynth.h"
+#include "xyresolve.h"
+#include "xyunion.h"
+
+#define MAX_THREADS 64
+#define BLOCK_EVENTS 1024
+#define MAX_REDRAWS 100000              // draws of an event before giving up on a hit
+#define SIM_MULT_BINS 17                // MatchStats per truth multiplicity, last one 16 and more
+
+typedef struct {
+    const SimConfig *cfg;
+    unsigned long long seed;
+    int reconstruct;
+    int threshold;                      // 0: selThreshold() of the event
+    double radius;
+    double tolerance;                   // > 0: strip ownership resolution instead of the clustering
+    int unionClustering;                // connected components instead of the greedy clustering
+    long block;
+    int nEvents;
+    PixelHit *hits;                     // BLOCK_EVENTS * SIM_MAX_HITS
+    int hitOffset[BLOCK_EVENTS + 1];
+    TruthPoint *truth;                  // BLOCK_EVENTS * SIM_MAX_PARTICLES
+    int truthOffset[BLOCK_EVENTS + 1];
+    MatchStats stats[SIM_MULT_BINS];
+    EventResult res;
+    ResolveWork *resolve;
+    int failed;
+    int noHit;                          // MAX_REDRAWS draws without a hit, nEvents cut there
+} SimBlock;
+
+static unsigned long long blockSeed(unsigned long long seed, long block){
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ULL * (unsigned long long)(block + 1);   // splitmix64
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void *simulateBlock(void *arg){
+    SimBlock *b = (SimBlock *)arg;
+    SynthRng rng;
+    seedSynthRng(&rng, blockSeed(b->seed, b->block));
+    b->hitOffset[0] = b->truthOffset[0] = 0;
+    for (int e = 0; e < b->nEvents; e++){
+        PixelHit *hits = b->hits + b->hitOffset[e];
+        TruthPoint *truth = b->truth + b->truthOffset[e];
+        int nTruth, nHits = 0;
+        for (int draw = 0; draw < MAX_REDRAWS && nHits == 0; draw++)     // nothing is read out without a hit
+            nHits = simulateEvent(&rng, b->cfg, hits, truth, &nTruth);
+        if (nHits == 0){
+            b->noHit = 1;
+            b->nEvents = e;
+            break;
+        }
+        b->hitOffset[e + 1] = b->hitOffset[e] + nHits;
+        b->truthOffset[e + 1] = b->truthOffset[e] + nTruth;
+        if (!b->reconstruct) continue;
+        int threshold = b->threshold > 0 ? b->threshold : selThreshold(nHits);
+        int rc;
+        if (b->tolerance > 0) rc = resolveEvent(hits, nHits, b->tolerance, &b->res, b->resolve);
+        else if (b->unionClustering) rc = reconstructEventUnion(hits, nHits, threshold, &b->res, 1);
+        else rc = reconstructEvent(hits, nHits, threshold, &b->res);
+        if (rc != 0){
+            b->failed = 1;
+            continue;
+        }
+        int bin = nTruth < SIM_MULT_BINS - 1 ? nTruth : SIM_MULT_BINS - 1;
+        matchTruth(truth, nTruth, b->res.centroids, b->res.nClusters, b->radius, &b->stats[bin]);
+    }
+    return NULL;
+}
+
+static void writeBlock(const SimBlock *b, long firstEvent, TextBuffer *events, ArchiveWriter *archive,
+                       TextBuffer *truthOut){
+    for (int e = 0; e < b->nEvents; e++){
+        const PixelHit *hits = b->hits + b->hitOffset[e];
+        int nHits = b->hitOffset[e + 1] - b->hitOffset[e];
+        if (events != NULL){
+            putInt(events, nHits);
+            for (int i = 0; i < nHits; i++){
+                putChar(events, ' ');
+                putInt(events, hits[i].row);
+                putChar(events, ' ');
+                putInt(events, hits[i].col);
+            }
+            putChar(events, '\n');
+        }
+        if (archive != NULL) writeArchiveEvent(archive, hits, nHits);
+        if (truthOut != NULL){
+            for (int p = b->truthOffset[e]; p < b->truthOffset[e + 1]; p++){
+                putInt(truthOut, firstEvent + e);
+                putChar(truthOut, ';');
+                putInt(truthOut, p - b->truthOffset[e]);
+                putChar(truthOut, ';');
+                putFixed(truthOut, b->truth[p].x, 4);
+                putChar(truthOut, ';');
+                putFixed(truthOut, b->truth[p].y, 4);
+                putChar(truthOut, '\n');
+            }
+        }
+    }
+}
+
+static void printMatchStats(const char *label, const MatchStats *s){
+    if (s->events == 0) return;
+    double n = s->matched > 0 ? (double)s->matched : 1;
+    double meanDx = s->sumDx / n, meanDy = s->sumDy / n;
+    printf("%s;%ld;%ld;%.4f;%.4f;%.3f;%.3f;%.3f;%.3f\n", label, s->events, s->particles,
+           s->particles > 0 ? (double)s->matched / s->particles : 0.0, (double)s->ghosts / s->events,
+           meanDx, meanDy, sqrt(fmax(s->sumDx2 / n - meanDx*meanDx, 0)), sqrt(fmax(s->sumDy2 / n - meanDy*meanDy, 0)));
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static void usage(const char *prog){
+    printf("Usage: %s -n <events> [-o <event file>] [-p <archive>] [-u <truth file>] [-t <threads>] [-s <seed>]\n", prog);
+    printf("          [-m <mean particles>] [-b <x> <y> <sigma>] [-f <strip efficiency>] [-c <sharing um>]\n");
+    printf("          [-z <mean noise pixels>] [-R] [-r <match radius um>] [-x <threshold um>] [-A <tolerance strips> | -U]\n");
+}
+
+int main(int argc, char *argv[]){
+    const char *eventFile = NULL, *archiveFile = NULL, *truthFile = NULL;
+    long nEvents = 0;
+    int nThreads = 1, reconstruct = 0, threshold = 0;
+    unsigned long long seed = 1;
+    double radius = 50, tolerance = 0;
+    int unionClustering = 0;
+    SimConfig cfg;
+    defaultSimConfig(&cfg);
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) nEvents = atol(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) eventFile = argv[++i];
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) archiveFile = argv[++i];
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) truthFile = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) nThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) cfg.multiplicity = atof(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 3 < argc){
+            cfg.beamX = atof(argv[++i]);
+            cfg.beamY = atof(argv[++i]);
+            cfg.beamSigma = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) cfg.efficiency = atof(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) cfg.sharing = atof(argv[++i]);
+        else if (strcmp(argv[i], "-z") == 0 && i + 1 < argc) cfg.noise = atof(argv[++i]);
+        else if (strcmp(argv[i], "-R") == 0) reconstruct = 1;
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) radius = atof(argv[++i]);
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) threshold = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "-U") == 0) unionClustering = 1;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nEvents <= 0){
+        usage(argv[0]);
+        return 1;
+    }
+    if ((cfg.multiplicity <= 0 || cfg.efficiency <= 0) && cfg.noise <= 0){
+        fprintf(stderr, "No hit can be drawn: -m and -f or -z have to be above 0\n");
+        return 1;
+    }
+    if (nThreads < 1) nThreads = 1;
+    if (nThreads > MAX_THREADS) nThreads = MAX_THREADS;
+    initStripPixelTable();
+
+    FILE *eventOut = NULL, *archiveOut = NULL, *truthOut = NULL;
+    TextBuffer events, truth;
+    ArchiveWriter *archive = NULL;
+    if (eventFile != NULL && (eventOut = fopen(eventFile, "w")) == NULL){
+        perror(eventFile);
+        return 1;
+    }
+    if (archiveFile != NULL){
+        if ((archiveOut = fopen(archiveFile, "wb")) == NULL){
+            perror(archiveFile);
+            return 1;
+        }
+        if ((archive = createArchiveWriter(archiveOut, ARCHIVE_BLOCK_EVENTS, 1)) == NULL) return 1;
+    }
+    if (truthFile != NULL && (truthOut = fopen(truthFile, "w")) == NULL){
+        perror(truthFile);
+        return 1;
+    }
+    if (eventOut != NULL) initTextBuffer(&events, eventOut, TEXT_BUFFER_SIZE);
+    if (truthOut != NULL){
+        initTextBuffer(&truth, truthOut, TEXT_BUFFER_SIZE);
+        putText(&truth, "event;particle;x;y\n");
+    }
+
+    SimBlock *blocks = (SimBlock *)calloc(nThreads, sizeof(SimBlock));
+    if (blocks == NULL){
+        fprintf(stderr, "Cannot allocate the blocks\n");
+        return 1;
+    }
+    for (int t = 0; t < nThreads; t++){
+        blocks[t].cfg = &cfg;
+        blocks[t].seed = seed;
+        blocks[t].reconstruct = reconstruct;
+        blocks[t].threshold = threshold;
+        blocks[t].radius = radius;
+        blocks[t].tolerance = tolerance;
+        blocks[t].unionClustering = unionClustering;
+        blocks[t].hits = (PixelHit *)malloc((size_t)BLOCK_EVENTS * SIM_MAX_HITS * sizeof(PixelHit));
+        blocks[t].truth = (TruthPoint *)malloc((size_t)BLOCK_EVENTS * SIM_MAX_PARTICLES * sizeof(TruthPoint));
+        initEventResult(&blocks[t].res);
+        if (tolerance > 0) blocks[t].resolve = createResolveWork();
+        if (blocks[t].hits == NULL || blocks[t].truth == NULL || (tolerance > 0 && blocks[t].resolve == NULL)){
+            fprintf(stderr, "Cannot allocate the blocks\n");
+            return 1;
+        }
+    }
+
+    // rounds of one block per thread, written in block order
+    double start = now();
+    long nBlocks = (nEvents + BLOCK_EVENTS - 1) / BLOCK_EVENTS;
+    int failed = 0, noHit = 0;
+    long written = 0;
+    for (long first = 0; first < nBlocks && !noHit; first += nThreads){
+        pthread_t tids[MAX_THREADS];
+        int threaded[MAX_THREADS];
+        for (int t = 0; t < nThreads && first + t < nBlocks; t++){
+            SimBlock *b = &blocks[t];
+            b->block = first + t;
+            b->nEvents = (int)(b->block == nBlocks - 1 ? nEvents - b->block * BLOCK_EVENTS : BLOCK_EVENTS);
+            b->noHit = 0;
+            threaded[t] = nThreads > 1 && pthread_create(&tids[t], NULL, simulateBlock, b) == 0;
+            if (!threaded[t]) simulateBlock(b);
+        }
+        for (int t = 0; t < nThreads && first + t < nBlocks; t++){
+            if (threaded[t]) pthread_join(tids[t], NULL);
+            if (noHit) continue;        // events after the gap are not written
+            noHit = blocks[t].noHit;
+            written += blocks[t].nEvents;
+            writeBlock(&blocks[t], blocks[t].block * BLOCK_EVENTS, eventOut != NULL ? &events : NULL, archive,
+                       truthOut != NULL ? &truth : NULL);
+        }
+    }
+    double elapsed = now() - start;
+
+    if (eventOut != NULL){
+        freeTextBuffer(&events);
+        if (fclose(eventOut) != 0) failed = 1;
+    }
+    if (archive != NULL && closeArchiveWriter(archive) != 0) failed = 1;
+    if (archiveOut != NULL && fclose(archiveOut) != 0) failed = 1;
+    if (truthOut != NULL){
+        freeTextBuffer(&truth);
+        if (fclose(truthOut) != 0) failed = 1;
+    }
+
+    MatchStats total, bins[SIM_MULT_BINS];
+    memset(&total, 0, sizeof(total));
+    memset(bins, 0, sizeof(bins));
+    for (int t = 0; t < nThreads; t++){
+        for (int k = 0; k < SIM_MULT_BINS; k++){
+            mergeMatchStats(&bins[k], &blocks[t].stats[k]);
+            mergeMatchStats(&total, &blocks[t].stats[k]);
+        }
+        if (blocks[t].failed) failed = 1;
+        free(blocks[t].hits);
+        free(blocks[t].truth);
+        freeEventResult(&blocks[t].res);
+        freeResolveWork(blocks[t].resolve);
+    }
+    free(blocks);
+    fprintf(stderr, "%ld events in %.2f s (%.0f events/s, %d threads)\n", written, elapsed, written / elapsed, nThreads);
+    if (reconstruct){
+        printf("particles;events;truth;efficiency;ghostsPerEvent;meanDx;meanDy;rmsDx;rmsDy\n");
+        for (int k = 0; k < SIM_MULT_BINS; k++){
+            char label[16];
+            snprintf(label, sizeof(label), k == SIM_MULT_BINS - 1 ? "%d+" : "%d", k);
+            printMatchStats(label, &bins[k]);
+        }
+        printMatchStats("all", &total);
+    }
+    if (noHit){
+        fprintf(stderr, "No hit in %d draws of an event, stopped (-m, -f and -z too low)\n", MAX_REDRAWS);
+        failed = 1;
+    }
+    if (failed) fprintf(stderr, "Some events could not be written or reconstructed\n");
+    return failed;
+}
@@ -0,0 +1,165 @@
+// Threshold sweep: the single linkage hierarchy of every event (xyunion.h) built once and cut
+// at a list of thresholds, to tune the selThreshold() table in one pass over a run.
+//   xysweep.exe [-e <event file>] [-x <thresholds um, 100,250,500,1500>] [-b <hit band edges, 15,20,30>]
+//               [-o <centroid file>]
+// Prints per hit band and threshold the events, clusters and 3-color centroids per event;
+// -o writes the 3-color centroids of every cut as event;threshold;numCluster;centroidFlag;
+// centroid3Colors;x;y.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "xypicmic.h"
+#include "xybatch.h"
+#include "xyunion.h"
+
+#define MAX_VALUES 64
+
+typedef struct {
+    long events;
+    long clusters;
+    long centroids3;
+    long eventsWith3;                   // events with at least one 3-color centroid
+} CutStats;
+
+// "100,250,500" into values[], -1 when empty or not increasing
+static int parseList(const char *text, int *values){
+    int n = 0;
+    const char *p = text;
+    while (*p != '\0' && n < MAX_VALUES){
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0 || (n > 0 && v <= values[n - 1])) return -1;
+        values[n++] = (int)v;
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return -1;
+    }
+    return n > 0 ? n : -1;
+}
+
+static int bandOf(const int *edges, int nEdges, int nHits){
+    int b = 0;
+    while (b < nEdges && nHits >= edges[b]) b++;
+    return b;
+}
+
+static void writeCut(TextBuffer *out, long event, const ThresholdCut *cut){
+    for (int k = 0; k < cut->nClusters; k++){
+        const IntersectionPoint *c = &cut->centroids[k];
+        if (c->flag != 7) continue;
+        putInt(out, event);
+        putChar(out, ';');
+        putInt(out, cut->threshold);
+        putChar(out, ';');
+        putInt(out, c->num);
+        putChar(out, ';');
+        putInt(out, (int)c->flag);
+        putChar(out, ';');
+        putInt(out, c->intersects);
+        putChar(out, ';');
+        putFixed(out, c->x, 4);
+        putChar(out, ';');
+        putFixed(out, c->y, 4);
+        putChar(out, '\n');
+    }
+}
+
+static void usage(const char *prog){
+    printf("Usage: %s [-e <event file>] [-x <thresholds um, 100,250,500,1500>] [-b <hit band edges, 15,20,30>]\n", prog);
+    printf("          [-o <centroid file>]\n");
+}
+
+int main(int argc, char *argv[]){
+    const char *eventFile = NULL, *centroidFile = NULL;
+    int thresholds[MAX_VALUES] = {100, 250, 500, 1500}, edges[MAX_VALUES] = {15, 20, 30};    // as selThreshold()
+    int nThresholds = 4, nEdges = 3;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) eventFile = argv[++i];
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) nThresholds = parseList(argv[++i], thresholds);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) nEdges = parseList(argv[++i], edges);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) centroidFile = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nThresholds < 0 || nEdges < 0){
+        fprintf(stderr, "Lists are increasing positive values separated by commas\n");
+        return 1;
+    }
+
+    FILE *in = eventFile == NULL || strcmp(eventFile, "-") == 0 ? stdin : fopen(eventFile, "rb");
+    if (in == NULL){
+        perror(eventFile);
+        return 1;
+    }
+    FILE *out = NULL;
+    if (centroidFile != NULL && (out = fopen(centroidFile, "w")) == NULL){
+        perror(centroidFile);
+        return 1;
+    }
+    EventSource src;
+    if (openEventSource(&src, in) != 0) return 1;
+    initStripPixelTable();
+    SweepWork *work = createSweepWork(thresholds, nThresholds);
+    CutStats *stats = (CutStats *)calloc((nEdges + 1) * nThresholds, sizeof(CutStats));
+    if (work == NULL || stats == NULL){
+        fprintf(stderr, "Cannot allocate the sweep\n");
+        return 1;
+    }
+    TextBuffer text;
+    if (out != NULL){
+        initTextBuffer(&text, out, 1 << 16);
+        putText(&text, "event;threshold;numCluster;centroidFlag; centroid3Colors;x;y\n");
+    }
+
+    EventResult res;
+    initEventResult(&res);
+    PixelHit *hits = NULL;
+    int hitCap = 0, nHits, rc, failed = 0;
+    long event = 0;
+    clock_t start = clock();
+    for (; (rc = readEvent(&src, &hits, &hitCap, &nHits)) == 1; event++){
+        if (sweepEvent(hits, nHits, &res, work) != 0){
+            fprintf(stderr, "Out of memory in event %ld\n", event);
+            failed = 1;
+            break;
+        }
+        CutStats *band = &stats[bandOf(edges, nEdges, nHits) * nThresholds];
+        for (int k = 0; k < work->nCuts; k++){
+            band[k].events++;
+            band[k].clusters += work->cuts[k].nClusters;
+            band[k].centroids3 += work->cuts[k].nClusters3;
+            band[k].eventsWith3 += work->cuts[k].nClusters3 > 0;
+            if (out != NULL) writeCut(&text, event, &work->cuts[k]);
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // selected: the threshold selThreshold() takes for the band (its lowest hit count)
+    printf("hits;threshold;events;clustersPerEvent;centroids3PerEvent;eventsWith3;selected\n");
+    for (int b = 0; b <= nEdges; b++){
+        int low = b > 0 ? edges[b - 1] : 0;
+        for (int k = 0; k < nThresholds; k++){
+            const CutStats *s = &stats[b * nThresholds + k];
+            if (s->events == 0) continue;
+            if (b < nEdges) printf("%d-%d;", low, edges[b] - 1);
+            else printf("%d-;", low);
+            printf("%d;%ld;%.3f;%.3f;%ld;%d\n", work->cuts[k].threshold, s->events, (double)s->clusters / s->events,
+                   (double)s->centroids3 / s->events, s->eventsWith3, selThreshold(low) == work->cuts[k].threshold);
+        }
+    }
+    fprintf(stderr, "%ld events, %d thresholds in %.2f s\n", event, nThresholds, seconds);
+
+    if (out != NULL){
+        freeTextBuffer(&text);
+        if (fclose(out) != 0) failed = 1;
+    }
+    closeEventSource(&src);
+    if (in != stdin) fclose(in);
+    freeEventResult(&res);
+    freeSweepWork(work);
+    free(stats);
+    free(hits);
+    return failed || rc < 0;
+}
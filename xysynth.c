@@ -0,0 +1,237 @@
+#include "xysynth.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void seedSynthRng(SynthRng *rng, unsigned long long seed){
+    rng->state = 0x9E3779B97F4A7C15ULL ^ seed * 0xBF58476D1CE4E5B9ULL;
+    if (rng->state == 0) rng->state = 1;
+}
+
+double synthUniform(SynthRng *rng){
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return (double)((rng->state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static void addStrip(PixelHit *hits, int *n, int color, int value){
+    if (value < 0 || value >= STRIP_SLOTS || stripPixel[color][value] < 0) return;
+    hits[*n].row = stripPixel[color][value] / COLS;
+    hits[*n].col = stripPixel[color][value] % COLS;
+    (*n)++;
+}
+
+// At most SYNTH_MAX_HITS(maxTracks) hits
+int syntheticEvent(SynthRng *rng, PixelHit *hits, int maxTracks){
+    int n = 0;
+    int tracks = 1 + (int)(synthUniform(rng) * maxTracks);
+    for (int t = 0; t < tracks; t++){
+        double y = (synthUniform(rng) - 0.5) * 852*7.5*0.9;
+        double x = (synthUniform(rng) - 0.5) * 852*7.5*0.9;
+        int strips[3];
+        stripsAtPoint(x, y, strips);
+        for (int c = 0; c < 3; c++){
+            if (synthUniform(rng) < 0.05) continue;
+            addStrip(hits, &n, c, strips[c]);
+            if (synthUniform(rng) < 0.3) addStrip(hits, &n, c, strips[c] + (synthUniform(rng) < 0.5 ? -1 : 1));
+        }
+    }
+    int noise = (int)(synthUniform(rng) * 4);
+    for (int k = 0; k < noise; k++){
+        hits[n].row = (int)(synthUniform(rng) * ROWS);
+        hits[n].col = (int)(synthUniform(rng) * COLS);
+        n++;
+    }
+    for (int i = n - 1; i > 0; i--){
+        int j = (int)(synthUniform(rng) * (i + 1));
+        PixelHit tmp = hits[i]; hits[i] = hits[j]; hits[j] = tmp;
+    }
+    return n;
+}
+
+// ----------------------------------------------------------------
+// Monte Carlo
+// ----------------------------------------------------------------
+
+static const int stripFirst[3] = {1, 0, 2};        // strips of each color, as in the address table
+static const int stripLast[3] = {852, 851, 853};
+
+void defaultSimConfig(SimConfig *cfg){
+    cfg->multiplicity = 1;
+    cfg->beamX = cfg->beamY = 0;
+    cfg->beamSigma = 0;
+    cfg->efficiency = 0.99;
+    cfg->sharing = 1.0;
+    cfg->noise = 0.5;
+}
+
+static int poisson(SynthRng *rng, double mean, int max){
+    double limit = exp(-mean), p = synthUniform(rng);
+    int k = 0;
+    while (p > limit && k < max){
+        p *= synthUniform(rng);
+        k++;
+    }
+    return k;
+}
+
+static double gaussian(SynthRng *rng){
+    double u = synthUniform(rng), v = synthUniform(rng);
+    return sqrt(-2*log(1 - u)) * cos(2*PI*v);
+}
+
+static int inAcceptance(const double u[3]){
+    for (int c = 0; c < 3; c++){
+        long s = lround(u[c]);
+        if (s < stripFirst[c] || s > stripLast[c]) return 0;
+    }
+    return 1;
+}
+
+static void fireStrip(SynthRng *rng, const SimConfig *cfg, int color, long strip, PixelHit *hits, int *n,
+                      unsigned char *seen){
+    if (strip < stripFirst[color] || strip > stripLast[color] || synthUniform(rng) >= cfg->efficiency) return;
+    int pixel = stripPixel[color][strip];
+    if (pixel < 0 || (seen[pixel >> 3] & (1 << (pixel & 7)))) return;
+    seen[pixel >> 3] |= (unsigned char)(1 << (pixel & 7));
+    hits[*n].row = pixel / COLS;
+    hits[*n].col = pixel % COLS;
+    (*n)++;
+}
+
+// One event: returns its hits (at most SIM_MAX_HITS, shuffled readout order) and fills the
+// truth (at most SIM_MAX_PARTICLES). initStripPixelTable() first.
+int simulateEvent(SynthRng *rng, const SimConfig *cfg, PixelHit *hits, TruthPoint *truth, int *nTruth){
+    unsigned char seen[(NUM_PIXELS + 7) / 8];
+    memset(seen, 0, sizeof(seen));
+    double Ymax = 852*7.5*0.5, Xmax = (Ymax*2)/sqrt(3);
+    int n = 0;
+    int particles = poisson(rng, cfg->multiplicity, SIM_MAX_PARTICLES);
+    *nTruth = 0;
+    for (int p = 0; p < particles; p++){
+        double x, y, u[3];
+        int tries = 0;
+        do {
+            if (cfg->beamSigma > 0){
+                x = cfg->beamX + cfg->beamSigma * gaussian(rng);
+                y = cfg->beamY + cfg->beamSigma * gaussian(rng);
+            } else {
+                x = (2*synthUniform(rng) - 1) * Xmax;
+                y = (2*synthUniform(rng) - 1) * Ymax;
+            }
+            stripCoordinates(x, y, u);
+        } while (!inAcceptance(u) && ++tries < 1000);
+        if (tries == 1000) continue;
+        truth[*nTruth].x = x;
+        truth[(*nTruth)++].y = y;
+        for (int c = 0; c < 3; c++){
+            long strip = lround(u[c]);
+            double offset = u[c] - strip;                   // -0.5 .. 0.5 strip
+            fireStrip(rng, cfg, c, strip, hits, &n, seen);
+            if ((0.5 - fabs(offset)) * 7.5 < cfg->sharing)
+                fireStrip(rng, cfg, c, strip + (offset < 0 ? -1 : 1), hits, &n, seen);
+        }
+    }
+    int noise = poisson(rng, cfg->noise, SIM_MAX_NOISE);
+    for (int k = 0; k < noise; k++){
+        int pixel = (int)(synthUniform(rng) * NUM_PIXELS);
+        if (seen[pixel >> 3] & (1 << (pixel & 7))) continue;
+        seen[pixel >> 3] |= (unsigned char)(1 << (pixel & 7));
+        hits[n].row = pixel / COLS;
+        hits[n].col = pixel % COLS;
+        n++;
+    }
+    for (int i = n - 1; i > 0; i--){
+        int j = (int)(synthUniform(rng) * (i + 1));
+        PixelHit tmp = hits[i]; hits[i] = hits[j]; hits[j] = tmp;
+    }
+    return n;
+}
+
+typedef struct {
+    double d2;
+    int truth;
+    int centroid;
+} MatchPair;
+
+static int comparePairs(const void *a, const void *b){
+    const MatchPair *x = (const MatchPair *)a, *y = (const MatchPair *)b;
+    if (x->d2 != y->d2) return x->d2 < y->d2 ? -1 : 1;
+    if (x->truth != y->truth) return x->truth - y->truth;
+    return x->centroid - y->centroid;
+}
+
+#define MAX_MATCH_PAIRS 4096
+
+// Matches the 3-color centroids (those written to centroid.csv) to the truth, closest pairs
+// first, each particle and centroid used once. Candidates come from a window on the truth
+// sorted by x. Returns the number of matched particles and adds the event to stats.
+int matchTruth(const TruthPoint *truth, int nTruth, const IntersectionPoint *centroids, int nCentroids,
+               double radius, MatchStats *stats){
+    int order[SIM_MAX_PARTICLES];
+    unsigned char truthUsed[SIM_MAX_PARTICLES];
+    MatchPair pairs[MAX_MATCH_PAIRS];
+    int nPairs = 0, matched = 0, threeColor = 0;
+    if (nTruth > SIM_MAX_PARTICLES) nTruth = SIM_MAX_PARTICLES;
+
+    for (int i = 0; i < nTruth; i++){             // insertion sort by x, nTruth is small
+        int k = i;
+        while (k > 0 && truth[order[k-1]].x > truth[i].x){
+            order[k] = order[k-1];
+            k--;
+        }
+        order[k] = i;
+        truthUsed[i] = 0;
+    }
+    for (int c = 0; c < nCentroids; c++){
+        if (centroids[c].num < 0 || centroids[c].flag != 7) continue;
+        threeColor++;
+        int lo = 0, hi = nTruth;                    // first truth with x >= cx - radius
+        while (lo < hi){
+            int mid = (lo + hi) / 2;
+            if (truth[order[mid]].x < centroids[c].x - radius) lo = mid + 1;
+            else hi = mid;
+        }
+        for (int k = lo; k < nTruth && truth[order[k]].x <= centroids[c].x + radius && nPairs < MAX_MATCH_PAIRS; k++){
+            double dx = centroids[c].x - truth[order[k]].x, dy = centroids[c].y - truth[order[k]].y;
+            if (dx*dx + dy*dy <= radius*radius){
+                pairs[nPairs].d2 = dx*dx + dy*dy;
+                pairs[nPairs].truth = order[k];
+                pairs[nPairs++].centroid = c;
+            }
+        }
+    }
+    qsort(pairs, nPairs, sizeof(MatchPair), comparePairs);
+    unsigned char *centroidUsed = (unsigned char *)calloc(nCentroids > 0 ? nCentroids : 1, 1);
+    for (int k = 0; k < nPairs && centroidUsed != NULL; k++){
+        if (truthUsed[pairs[k].truth] || centroidUsed[pairs[k].centroid]) continue;
+        truthUsed[pairs[k].truth] = centroidUsed[pairs[k].centroid] = 1;
+        double dx = centroids[pairs[k].centroid].x - truth[pairs[k].truth].x;
+        double dy = centroids[pairs[k].centroid].y - truth[pairs[k].truth].y;
+        stats->sumDx += dx;
+        stats->sumDy += dy;
+        stats->sumDx2 += dx*dx;
+        stats->sumDy2 += dy*dy;
+        matched++;
+    }
+    free(centroidUsed);
+    stats->events++;
+    stats->particles += nTruth;
+    stats->matched += matched;
+    stats->centroids += threeColor;
+    stats->ghosts += threeColor - matched;
+    return matched;
+}
+
+void mergeMatchStats(MatchStats *into, const MatchStats *from){
+    into->events += from->events;
+    into->particles += from->particles;
+    into->matched += from->matched;
+    into->centroids += from->centroids;
+    into->ghosts += from->ghosts;
+    into->sumDx += from->sumDx;
+    into->sumDy += from->sumDy;
+    into->sumDx2 += from->sumDx2;
+    into->sumDy2 += from->sumDy2;
+}
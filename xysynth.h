@@ -0,0 +1,58 @@
+#ifndef XYSYNTH_H
+#define XYSYNTH_H
+
+#include "xypicmic.h"
+
+// Synthetic events for the test and load tools: tracks crossing the sensor (3 strips each,
+// sometimes a neighbor strip too, 5% inefficiency per strip) plus noise pixels anywhere in
+// the table, dummy cells included, in shuffled readout order. initStripPixelTable() first.
+
+#define SYNTH_MAX_HITS(maxTracks) ((maxTracks)*6 + 4)
+
+typedef struct {
+    unsigned long long state;           // xorshift64*, one per thread
+} SynthRng;
+
+void seedSynthRng(SynthRng *rng, unsigned long long seed);
+double synthUniform(SynthRng *rng);
+int syntheticEvent(SynthRng *rng, PixelHit *hits, int maxTracks);
+
+// Monte Carlo: particles thrown on the sensor, the strips they cross (geometry of
+// calculateLineCoordinates(), charge shared with the neighbor strip near a strip edge)
+// read out through the address table, plus noise pixels. The particle positions are the truth.
+
+#define SIM_MAX_PARTICLES 64
+#define SIM_MAX_NOISE 64
+#define SIM_MAX_HITS (SIM_MAX_PARTICLES*6 + SIM_MAX_NOISE)
+
+typedef struct {
+    double multiplicity;                // mean particles per event (Poisson)
+    double beamX;                       // Gaussian beam spot in um,
+    double beamY;
+    double beamSigma;                   // 0 for particles spread over the whole sensor
+    double efficiency;                  // per strip
+    double sharing;                     // um from a strip edge where the neighbor strip fires too
+    double noise;                       // mean noise pixels per event (Poisson)
+} SimConfig;
+
+typedef struct {
+    double x;
+    double y;
+} TruthPoint;
+
+typedef struct {
+    long events;
+    long particles;
+    long matched;                       // particles with a 3-color centroid within the radius
+    long centroids;                     // 3-color centroids
+    long ghosts;                        // 3-color centroids matched to no particle
+    double sumDx, sumDy, sumDx2, sumDy2;
+} MatchStats;
+
+void defaultSimConfig(SimConfig *cfg);
+int simulateEvent(SynthRng *rng, const SimConfig *cfg, PixelHit *hits, TruthPoint *truth, int *nTruth);
+int matchTruth(const TruthPoint *truth, int nTruth, const IntersectionPoint *centroids, int nCentroids,
+               double radius, MatchStats *stats);
+void mergeMatchStats(MatchStats *into, const MatchStats *from);
+
+#endif /* XYSYNTH_H */
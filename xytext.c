@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "xytext.h"
+
+#define SLACK 16                        // readable bytes past the end of the data
+#define BYTES(b) (0x0101010101010101ULL * (b))
+
+int openTextEventReader(TextEventReader *r, FILE *in){
+    memset(r, 0, sizeof(TextEventReader));
+    r->in = in;
+    r->base = ftell(in) > 0 ? ftell(in) : 0;
+    r->cap = TEXT_BLOCK_SIZE;
+    r->buf = (char *)malloc(r->cap + SLACK);
+    if (r->buf == NULL){
+        fprintf(stderr, "Cannot allocate the input block\n");
+        return -1;
+    }
+    return 0;
+}
+
+void closeTextEventReader(TextEventReader *r){
+    free(r->buf);
+    memset(r, 0, sizeof(TextEventReader));
+}
+
+int seekTextEventReader(TextEventReader *r, int64_t offset){
+    if (fseek(r->in, (long)offset, SEEK_SET) != 0){
+        perror("Event input");
+        return -1;
+    }
+    clearerr(r->in);
+    r->pos = r->len = 0;
+    r->eof = 0;
+    r->base = offset;
+    return 0;
+}
+
+// Next line in buf[*start .. *end), the partial line moved to the front before each block
+// read; the byte at *end is '\n' on return. 0 at end of input, -1 on a read error.
+static int nextLine(TextEventReader *r, size_t *start, size_t *end){
+    for (;;){
+        char *nl = r->pos < r->len ? (char *)memchr(r->buf + r->pos, '\n', r->len - r->pos) : NULL;
+        if (nl != NULL){
+            *start = r->pos;
+            *end = (size_t)(nl - r->buf);
+            r->pos = *end + 1;
+            return 1;
+        }
+        if (r->eof){
+            if (r->pos == r->len) return 0;
+            *start = r->pos;                        // last line, without a newline
+            *end = r->len;
+            r->buf[r->len] = '\n';
+            r->pos = r->len;
+            return 1;
+        }
+        size_t keep = r->len - r->pos;
+        memmove(r->buf, r->buf + r->pos, keep);
+        r->base += (int64_t)r->pos;
+        r->pos = 0;
+        r->len = keep;
+        if (r->cap - r->len < TEXT_BLOCK_SIZE / 2){     // a line longer than half a block
+            char *buf = (char *)realloc(r->buf, 2*r->cap + SLACK);
+            if (buf == NULL){
+                fprintf(stderr, "Cannot allocate the input block\n");
+                return -1;
+            }
+            r->buf = buf;
+            r->cap *= 2;
+        }
+        size_t got = fread(r->buf + r->len, 1, r->cap - r->len, r->in);
+        r->len += got;
+        if (got == 0){
+            if (ferror(r->in)){
+                perror("Event input");
+                return -1;
+            }
+            r->eof = 1;
+        }
+    }
+}
+
+// Unsigned integer at *p, moved past it; -1 when there is none or it has more than 9 digits
+static long scanDigits(const char **p){
+    const char *s = *p;
+    long v = 0;
+    while (*s >= '0' && *s <= '9' && s - *p < 10) v = 10*v + (*s++ - '0');
+    if (s == *p || s - *p == 10) return -1;
+    *p = s;
+    return v;
+}
+
+// Same as scanDigits(), 8 bytes at a time: a byte is a digit when byte ^ '0' is at most 9,
+// the first non digit gives the length and the digits are combined pairwise, then by 4 and
+// by 8, with three multiplications. Numbers of 8 digits or more go to scanDigits().
+static long scanNumber(const char **p){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    memcpy(&v, *p, 8);
+    uint64_t t = v ^ BYTES(0x30);
+    uint64_t nondigit = ((t + BYTES(0x76)) | t) & BYTES(0x80);    // carries only move up, past the first hit
+    if (nondigit == 0) return scanDigits(p);
+    int len = __builtin_ctzll(nondigit) >> 3;
+    if (len == 0) return -1;
+    t <<= 8 * (8 - len);                            // leading zeros
+    t = (t * 10 + (t >> 8)) & 0x00FF00FF00FF00FFULL;
+    t = (t * 100 + (t >> 16)) & 0x0000FFFF0000FFFFULL;
+    t = (t * 10000 + (t >> 32)) & 0x00000000FFFFFFFFULL;
+    *p += len;
+    return (long)t;
+#else
+    return scanDigits(p);
+#endif
+}
+
+static const char *skipBlanks(const char *p){
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+int readTextEvent(TextEventReader *r, PixelHit **hits, int *hitCap, int *nHits){
+    size_t start, end;
+    int rc;
+    while ((rc = nextLine(r, &start, &end)) == 1){
+        r->line++;
+        const char *p = skipBlanks(r->buf + start), *last = r->buf + end;
+        if (*p == '#' || *p == '\r' || p == last) continue;
+        int length = (int)(end - start);
+        r->lineOffset = r->base + (int64_t)start;
+
+        long n = scanNumber(&p);
+        if (n < 1){
+            fprintf(stderr, "Invalid event line %ld: %.*s\n", r->line, length, r->buf + start);
+            return -1;
+        }
+        if (n > length / 4){                // a pair takes at least 4 characters, " r c"
+            fprintf(stderr, "Invalid number of row and column pairs in event line %ld: %.*s\n", r->line,
+                    length, r->buf + start);
+            return -1;
+        }
+        if (n > *hitCap){
+            PixelHit *h = (PixelHit *)realloc(*hits, n * sizeof(PixelHit));
+            if (h == NULL){
+                fprintf(stderr, "Cannot allocate %ld hits for event line %ld\n", n, r->line);
+                return -1;
+            }
+            *hits = h;
+            *hitCap = (int)n;
+        }
+        PixelHit *h = *hits;
+        long i = 0;
+        for (; i < n; i++){
+            p = skipBlanks(p);
+            long row = scanNumber(&p);
+            p = skipBlanks(p);
+            long col = scanNumber(&p);
+            if (row < 0 || col < 0) break;
+            if (row >= ROWS || col >= COLS){
+                fprintf(stderr, "Pixel %ld %ld out of range in event line %ld: %.*s\n", row, col, r->line,
+                        length, r->buf + start);
+                *nHits = (int)i;
+                return -1;
+            }
+            h[i].row = (int)row;
+            h[i].col = (int)col;
+        }
+        *nHits = (int)i;
+        p = skipBlanks(p);
+        if (*p == '\r') p++;
+        if (i != n || p != last){
+            fprintf(stderr, "Invalid number of row and column pairs in event line %ld: %.*s\n", r->line,
+                    length, r->buf + start);
+            return -1;
+        }
+        return 1;
+    }
+    return rc;
+}
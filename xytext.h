@@ -0,0 +1,35 @@
+#ifndef XYTEXT_H
+#define XYTEXT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "xypicmic.h"
+
+// Fast reader of the text event files (data_example_6.txt style, "<numElements> <row> <col> ..."
+// one event per line): the file is read in large blocks, lines are found with memchr() and
+// the integers are scanned 8 bytes at a time (SWAR digit classification and conversion, no
+// strtol()), straight into the hit array. Rows and columns are checked against ROWS and COLS.
+// Empty lines and lines starting with '#' are skipped.
+
+#define TEXT_BLOCK_SIZE (1 << 20)
+
+typedef struct {
+    FILE *in;
+    char *buf;                          // block, plus room for a sentinel
+    size_t cap;
+    size_t pos;                         // start of the next line
+    size_t len;                         // bytes in buf
+    int eof;
+    long line;                          // line number of the last event, for the messages
+    int64_t base;                       // file offset of buf[0]
+    int64_t lineOffset;                 // file offset of the last event line
+} TextEventReader;
+
+int openTextEventReader(TextEventReader *r, FILE *in);
+// Same contract as readEvent(): 1 event read, 0 end of input, -1 on a malformed or out
+// of range line (reported on stderr, the caller may go on with the next one)
+int readTextEvent(TextEventReader *r, PixelHit **hits, int *hitCap, int *nHits);
+void closeTextEventReader(TextEventReader *r);      // the FILE stays open
+int seekTextEventReader(TextEventReader *r, int64_t offset);   // next event from that line on
+
+#endif /* XYTEXT_H */
@@ -0,0 +1,475 @@
+#include "xyunion.h"
+#include "xyprobe.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#define MAX_THREADS 64
+
+typedef struct {
+    long long key;                      // grid cell, or strip pair
+    int index;
+} KeyEntry;
+
+typedef struct {
+    long long key;
+    long long cx;
+    long long cy;
+    int first;                          // its intersections, sorted[first .. first+count-1]
+    int count;
+    double xMin, xMax, yMin, yMax;      // bounding box of its intersections
+} GridCell;
+
+// Cell coordinates relative to the event's lowest cell, numbered row by row
+typedef struct {
+    long long cx0, cy0;
+    long long nx, ny;
+} GridFrame;
+
+typedef struct {
+    const IntersectionPoint *pts;
+    const KeyEntry *sorted;             // intersections by cell
+    const GridCell *cells;
+    int nCells;
+    const GridFrame *frame;
+    int *parent;
+    int threshold;
+    int ring;                           // 1: the 8 nearest cells, 2: the 12 further ones
+    int first;                          // cells whose links this task makes
+    int last;
+} UnionTask;
+
+static long long cellKey(const GridFrame *g, long long cx, long long cy){
+    if (cx < g->cx0 || cx >= g->cx0 + g->nx || cy < g->cy0 || cy >= g->cy0 + g->ny) return -1;
+    return (cx - g->cx0) * g->ny + (cy - g->cy0);
+}
+
+// Cells a bit smaller than threshold / sqrt(2): two points of one cell are always closer
+// than threshold, and a point only reaches the 5 x 5 cells around its own (corners excluded)
+static long long cellOf(double v, int threshold){
+    return (long long)floor(v / (threshold * sqrt(0.5) * (1 - 1e-12)));
+}
+
+static int compareKeys(const void *a, const void *b){
+    const KeyEntry *x = (const KeyEntry *)a, *y = (const KeyEntry *)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->index - y->index;
+}
+
+// Root of i, halving the path on the way (each visited node is pointed to its grandparent)
+static int findRoot(int *parent, int i){
+    for (;;){
+        int p = __atomic_load_n(&parent[i], __ATOMIC_ACQUIRE);
+        if (p == i) return i;
+        int gp = __atomic_load_n(&parent[p], __ATOMIC_ACQUIRE);
+        if (gp != p){
+            int expected = p;
+            __atomic_compare_exchange_n(&parent[i], &expected, gp, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
+        i = gp;
+    }
+}
+
+// The larger root goes below the smaller one, retried if another thread moved it first
+static void unite(int *parent, int a, int b){
+    for (;;){
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a == b) return;
+        if (a < b){
+            int t = a; a = b; b = t;
+        }
+        int expected = a;
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+    }
+}
+
+// First cell with a key >= key
+static int findCell(const GridCell *cells, int n, long long key){
+    int lo = 0, hi = n;
+    while (lo < hi){
+        int mid = (lo + hi) / 2;
+        if (cells[mid].key < key) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// Squared distance from (x, y) to the bounding box of a cell
+static double boxDistance2(const GridCell *c, double x, double y){
+    double dx = x < c->xMin ? c->xMin - x : (x > c->xMax ? x - c->xMax : 0);
+    double dy = y < c->yMin ? c->yMin - y : (y > c->yMax ? y - c->yMax : 0);
+    return dx*dx + dy*dy;
+}
+
+// First pair of points of a and b closer than threshold, looking only at the points
+// within threshold of the other cell's bounding box
+static void linkPair(UnionTask *t, const GridCell *a, const GridCell *b){
+    const IntersectionPoint *pts = t->pts;
+    const KeyEntry *pa = t->sorted + a->first, *pb = t->sorted + b->first;
+    double t2 = (double)t->threshold * t->threshold;
+    for (int i = 0; i < a->count; i++){
+        const IntersectionPoint *p = &pts[pa[i].index];
+        if (boxDistance2(b, p->x, p->y) >= t2) continue;
+        for (int j = 0; j < b->count; j++){
+            const IntersectionPoint *q = &pts[pb[j].index];
+            if (boxDistance2(a, q->x, q->y) >= t2) continue;
+            if (distance(p->x, p->y, q->x, q->y) < t->threshold){
+                unite(t->parent, pa[i].index, pb[j].index);
+                return;
+            }
+        }
+    }
+}
+
+// Ring 1 links the points of each cell together and each cell to its 8 nearest cells,
+// ring 2 to the 12 further cells a point can reach, mostly joined by then already.
+// Each pair of cells is looked at once, and not at all when both are in one component.
+// The cells of a column are consecutive, so for each of the columns dx = 0, 1, 2 a cursor
+// walks the sorted cells along with c instead of a search per neighbor.
+static void *linkCells(void *arg){
+    UnionTask *t = (UnionTask *)arg;
+    int cursor[3] = {0, 0, 0};
+    for (int c = t->first; c < t->last; c++){
+        const GridCell *a = &t->cells[c];
+        const KeyEntry *pa = t->sorted + a->first;
+        if (t->ring == 1)
+            for (int k = 1; k < a->count; k++) unite(t->parent, pa[0].index, pa[k].index);
+        for (int dx = 0; dx <= 2; dx++){
+            long long row = a->cy - 2 > t->frame->cy0 ? a->cy - 2 - t->frame->cy0 : 0;
+            long long low = (a->cx + dx - t->frame->cx0) * t->frame->ny + row;
+            if (c == t->first) cursor[dx] = findCell(t->cells, t->nCells, low);
+            while (cursor[dx] < t->nCells && t->cells[cursor[dx]].key < low) cursor[dx]++;
+            for (int n = cursor[dx]; n < t->nCells; n++){
+                const GridCell *b = &t->cells[n];
+                if (b->cx != a->cx + dx || b->cy > a->cy + 2) break;
+                long long dy = b->cy - a->cy;
+                int ring = dx == 2 || dy == 2 || dy == -2 ? 2 : 1;
+                if (ring != t->ring || (dx == 0 && dy <= 0) || (dx == 2 && (dy == 2 || dy == -2))) continue;
+                if (findRoot(t->parent, pa[0].index) == findRoot(t->parent, t->sorted[b->first].index)) continue;
+                linkPair(t, a, b);
+            }
+        }
+    }
+    return NULL;
+}
+
+// Stable LSD radix sort on the keys (all >= 0), a byte at a time up to the largest key;
+// qsort() for the small events, where the histograms would cost more than the sort
+static void radixSort(KeyEntry *keys, KeyEntry *tmp, int n, long long maxKey){
+    if (n < 256){
+        qsort(keys, n, sizeof(KeyEntry), compareKeys);
+        return;
+    }
+    for (int shift = 0; shift < 64 && (maxKey >> shift) > 0; shift += 8){
+        int count[257] = {0};
+        for (int i = 0; i < n; i++) count[((keys[i].key >> shift) & 0xFF) + 1]++;
+        for (int d = 0; d < 256; d++) count[d + 1] += count[d];
+        for (int i = 0; i < n; i++) tmp[count[(keys[i].key >> shift) & 0xFF]++] = keys[i];
+        memcpy(keys, tmp, n * sizeof(KeyEntry));
+    }
+}
+
+// Spatial grid of the n points at threshold: keys[0 .. n-1] sorted by cell (keys[n .. 2n-1]
+// as scratch), the distinct cells with their bounding boxes in cells[]. Returns their number.
+static int buildGrid(const IntersectionPoint *pts, int n, int threshold, KeyEntry *keys, GridCell *cells, GridFrame *frame){
+    *frame = (GridFrame){0, 0, 1, 1};
+    for (int i = 0; i < n; i++){
+        long long cx = cellOf(pts[i].x, threshold), cy = cellOf(pts[i].y, threshold);
+        if (i == 0 || cx < frame->cx0) frame->cx0 = cx;
+        if (i == 0 || cy < frame->cy0) frame->cy0 = cy;
+        if (i == 0 || cx > frame->nx) frame->nx = cx;               // highest cell for now
+        if (i == 0 || cy > frame->ny) frame->ny = cy;
+    }
+    frame->nx = frame->nx - frame->cx0 + 1;
+    frame->ny = frame->ny - frame->cy0 + 1;
+    for (int i = 0; i < n; i++){
+        keys[i].key = cellKey(frame, cellOf(pts[i].x, threshold), cellOf(pts[i].y, threshold));
+        keys[i].index = i;
+    }
+    radixSort(keys, keys + n, n, frame->nx * frame->ny - 1);
+    int nCells = 0;
+    for (int i = 0; i < n; i++){
+        const IntersectionPoint *p = &pts[keys[i].index];
+        if (nCells > 0 && cells[nCells - 1].key == keys[i].key){
+            GridCell *c = &cells[nCells - 1];
+            c->count++;
+            if (p->x < c->xMin) c->xMin = p->x;
+            if (p->x > c->xMax) c->xMax = p->x;
+            if (p->y < c->yMin) c->yMin = p->y;
+            if (p->y > c->yMax) c->yMax = p->y;
+            continue;
+        }
+        GridCell *c = &cells[nCells++];
+        c->key = keys[i].key;
+        c->cx = cellOf(p->x, threshold);
+        c->cy = cellOf(p->y, threshold);
+        c->first = i;
+        c->count = 1;
+        c->xMin = c->xMax = p->x;
+        c->yMin = c->yMax = p->y;
+    }
+    return nCells;
+}
+
+// Unites in parent[] every pair of the n points closer than threshold, on the grid at that
+// threshold, ring 1 then ring 2, the cells split over the threads. Pairs already in one
+// component are not looked at, so parent[] may hold the components of a lower threshold.
+static void linkGrid(const IntersectionPoint *pts, int n, int threshold, KeyEntry *keys, GridCell *cells, int *parent, int threads){
+    GridFrame frame;
+    int nCells = buildGrid(pts, n, threshold, keys, cells, &frame);
+    UnionTask tasks[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    int started[MAX_THREADS];
+    if (threads > nCells) threads = nCells;
+    for (int k = 0; k < threads; k++){
+        tasks[k].pts = pts;
+        tasks[k].sorted = keys;
+        tasks[k].cells = cells;
+        tasks[k].nCells = nCells;
+        tasks[k].frame = &frame;
+        tasks[k].parent = parent;
+        tasks[k].threshold = threshold;
+        tasks[k].first = (int)((long long)nCells * k / threads);
+        tasks[k].last = (int)((long long)nCells * (k + 1) / threads);
+    }
+    for (int ring = 1; ring <= 2; ring++){
+        for (int k = 0; k < threads; k++) tasks[k].ring = ring;
+        for (int k = 1; k < threads; k++) started[k] = pthread_create(&tids[k], NULL, linkCells, &tasks[k]) == 0;
+        linkCells(&tasks[0]);
+        for (int k = 1; k < threads; k++){
+            if (started[k]) pthread_join(tids[k], NULL);
+            else linkCells(&tasks[k]);
+        }
+    }
+}
+
+// Lines of one color by strip number (repeated strips by position)
+static void sortLines(const LineCoordinates *lines, int n, KeyEntry *order){
+    for (int i = 0; i < n; i++){
+        order[i].key = lines[i].val;
+        order[i].index = i;
+    }
+    qsort(order, n, sizeof(KeyEntry), compareKeys);
+}
+
+// Intersections in strip pair order (xLines() index of each), the same for any hit order:
+// Y-R and Y-B pairs by Y strip then R, B strip, then the R-B pairs
+static void canonicalOrder(const EventResult *res, KeyEntry *lineOrder, int *order){
+    int y = res->y_size, r = res->r_size, b = res->b_size, rowYellow = r + b;
+    const KeyEntry *ys = lineOrder, *rs = ys + y, *bs = rs + r;
+    sortLines(res->split, y, lineOrder);
+    sortLines(res->split + y, r, lineOrder + y);
+    sortLines(res->split + y + r, b, lineOrder + y + r);
+    int k = 0;
+    for (int i = 0; i < y; i++){
+        for (int j = 0; j < r; j++) order[k++] = ys[i].index * rowYellow + rs[j].index;
+        for (int j = 0; j < b; j++) order[k++] = ys[i].index * rowYellow + r + bs[j].index;
+    }
+    for (int i = 0; i < r; i++)
+        for (int j = 0; j < b; j++) order[k++] = y * rowYellow + rs[i].index * b + bs[j].index;
+}
+
+// Strips and every pairwise intersection of the event, as reconstructEvent()
+static int fillIntersections(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    res->threshold = threshold;
+    res->interCount = 0;
+    res->nClusters = 0;
+    if (reserveEventResult(res, nHits, 0) != 0) return -1;
+    XY_PROBE2(fill_lines_entry, res->event, nHits);
+    res->nLines = fillLinesFromHits(hits, nHits, res->lines, &res->y_size, &res->r_size, &res->b_size);
+    LineCoordinates *ylines = res->split;
+    LineCoordinates *rlines = ylines + res->y_size;
+    LineCoordinates *blines = rlines + res->r_size;
+    splitLineColor(res->lines, res->nLines, ylines, rlines, blines);
+    XY_PROBE4(fill_lines_exit, res->event, res->y_size, res->r_size, res->b_size);
+
+    int combinations = res->y_size*res->r_size + res->y_size*res->b_size + res->b_size*res->r_size;
+    if (combinations == 0) return 0;
+    if (reserveEventResult(res, nHits, combinations) != 0) return -1;
+    XY_PROBE4(xlines_entry, res->event, res->y_size, res->r_size, res->b_size);
+    xLines(res->intersections, combinations, ylines, res->y_size, rlines, res->r_size, blines, res->b_size, &res->interCount);
+    XY_PROBE2(xlines_exit, res->event, res->interCount);
+    return 0;
+}
+
+// Clusters of the components in parent[] (flattened here), numbered and summed in the strip
+// pair order into centroids[] and res->clusterOf; returns their number, the 3-color ones in *n3
+static int summarizeComponents(EventResult *res, int *parent, const int *order, int *clusterSize,
+                               unsigned char *bits, IntersectionPoint *centroids, int *n3){
+    int n = res->interCount;
+    int *rootCluster = clusterSize;                 // cluster of each root, then sizes
+    for (int i = 0; i < n; i++){
+        parent[i] = findRoot(parent, i);
+        rootCluster[i] = -1;
+    }
+    int nClusters = 0;
+    for (int k = 0; k < n; k++){
+        int i = order[k], root = parent[i];
+        if (rootCluster[root] < 0) rootCluster[root] = nClusters++;
+        res->clusterOf[i] = rootCluster[root];
+    }
+    memset(clusterSize, 0, nClusters * sizeof(int));
+    memset(bits, 0, nClusters);
+    for (int c = 0; c < nClusters; c++) centroids[c].x = centroids[c].y = 0;
+    for (int k = 0; k < n; k++){
+        int i = order[k], c = res->clusterOf[i];
+        centroids[c].x += res->intersections[i].x;
+        centroids[c].y += res->intersections[i].y;
+        bits[c] = fill_bits(bits[c], (int)res->intersections[i].flag);
+        clusterSize[c]++;
+    }
+    *n3 = 0;
+    for (int c = 0; c < nClusters; c++){
+        IntersectionPoint *p = &centroids[c];
+        p->x /= clusterSize[c];
+        p->y /= clusterSize[c];
+        p->flag = bits[c];
+        p->intersects = p->flag == 7;
+        p->num = c;
+        *n3 += p->intersects;
+    }
+    return nClusters;
+}
+
+int reconstructEventUnion(const PixelHit *hits, int nHits, int threshold, EventResult *res, int threads){
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (fillIntersections(hits, nHits, threshold, res) != 0) return -1;
+    int n = res->interCount;
+    if (n == 0) return 0;
+
+    int nLines = res->y_size + res->r_size + res->b_size;
+    KeyEntry *keys = (KeyEntry *)malloc((2*n + nLines) * sizeof(KeyEntry));
+    GridCell *cells = (GridCell *)malloc(n * sizeof(GridCell));
+    int *parent = (int *)malloc(n * sizeof(int));
+    int *clusterSize = (int *)malloc(n * sizeof(int));
+    int *order = (int *)malloc(n * sizeof(int));
+    unsigned char *bits = (unsigned char *)malloc(n);
+    if (keys == NULL || cells == NULL || parent == NULL || clusterSize == NULL || order == NULL || bits == NULL){
+        free(keys);
+        free(cells);
+        free(parent);
+        free(clusterSize);
+        free(order);
+        free(bits);
+        return -1;
+    }
+
+    XY_PROBE3(fill_centroids_entry, res->event, n, threshold);
+    for (int i = 0; i < n; i++) parent[i] = i;
+    linkGrid(res->intersections, n, threshold, keys, cells, parent, threads);
+
+    // canonical order: by strip pair, so that sums and numbering ignore the hit order
+    canonicalOrder(res, keys + 2*n, order);
+    int n3;
+    int nClusters = summarizeComponents(res, parent, order, clusterSize, bits, res->centroids, &n3);
+    res->nClusters = nClusters;
+    XY_PROBE3(fill_centroids_exit, res->event, n, nClusters);
+    free(keys);
+    free(cells);
+    free(parent);
+    free(clusterSize);
+    free(order);
+    free(bits);
+    return 0;
+}
+
+static int compareInt(const void *a, const void *b){
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+SweepWork *createSweepWork(const int *thresholds, int nThresholds){
+    SweepWork *work = (SweepWork *)calloc(1, sizeof(SweepWork));
+    int *sorted = (int *)malloc((nThresholds > 0 ? nThresholds : 1) * sizeof(int));
+    if (work == NULL || sorted == NULL || nThresholds < 1){
+        free(work);
+        free(sorted);
+        return NULL;
+    }
+    memcpy(sorted, thresholds, nThresholds * sizeof(int));
+    qsort(sorted, nThresholds, sizeof(int), compareInt);
+    work->cuts = (ThresholdCut *)calloc(nThresholds, sizeof(ThresholdCut));
+    if (work->cuts == NULL){
+        free(work);
+        free(sorted);
+        return NULL;
+    }
+    work->nCuts = nThresholds;
+    for (int k = 0; k < nThresholds; k++) work->cuts[k].threshold = sorted[k];
+    free(sorted);
+    return work;
+}
+
+void freeSweepWork(SweepWork *work){
+    if (work == NULL) return;
+    for (int k = 0; k < work->nCuts; k++) free(work->cuts[k].centroids);
+    free(work->cuts);
+    free(work->keys);
+    free(work->cells);
+    free(work->parent);
+    free(work->clusterSize);
+    free(work->order);
+    free(work->bits);
+    free(work);
+}
+
+// Grows the per event buffers of work to n intersections and nLines strips
+static int reserveSweepWork(SweepWork *work, int n, int nLines){
+    if (2*n + nLines > work->keyCap){
+        void *keys = realloc(work->keys, (2*n + nLines) * sizeof(KeyEntry));
+        if (keys == NULL) return -1;
+        work->keys = keys;
+        work->keyCap = 2*n + nLines;
+    }
+    if (n > work->pointCap){
+        void *cells = realloc(work->cells, n * sizeof(GridCell));
+        if (cells != NULL) work->cells = cells;
+        int *parent = (int *)realloc(work->parent, n * sizeof(int));
+        if (parent != NULL) work->parent = parent;
+        int *clusterSize = (int *)realloc(work->clusterSize, n * sizeof(int));
+        if (clusterSize != NULL) work->clusterSize = clusterSize;
+        int *order = (int *)realloc(work->order, n * sizeof(int));
+        if (order != NULL) work->order = order;
+        unsigned char *bits = (unsigned char *)realloc(work->bits, n);
+        if (bits != NULL) work->bits = bits;
+        if (cells == NULL || parent == NULL || clusterSize == NULL || order == NULL || bits == NULL) return -1;
+        work->pointCap = n;
+    }
+    for (int k = 0; k < work->nCuts; k++){
+        ThresholdCut *cut = &work->cuts[k];
+        if (cut->cap >= n) continue;
+        IntersectionPoint *centroids = (IntersectionPoint *)realloc(cut->centroids, n * sizeof(IntersectionPoint));
+        if (centroids == NULL) return -1;
+        cut->centroids = centroids;
+        cut->cap = n;
+    }
+    return 0;
+}
+
+int sweepEvent(const PixelHit *hits, int nHits, EventResult *res, SweepWork *work){
+    for (int k = 0; k < work->nCuts; k++) work->cuts[k].nClusters = work->cuts[k].nClusters3 = 0;
+    if (fillIntersections(hits, nHits, work->cuts[work->nCuts - 1].threshold, res) != 0) return -1;
+    int n = res->interCount;
+    if (n == 0) return 0;
+    if (reserveSweepWork(work, n, res->y_size + res->r_size + res->b_size) != 0) return -1;
+
+    XY_PROBE3(fill_centroids_entry, res->event, n, work->cuts[work->nCuts - 1].threshold);
+    KeyEntry *keys = (KeyEntry *)work->keys;
+    canonicalOrder(res, keys + 2*n, work->order);
+    for (int i = 0; i < n; i++) work->parent[i] = i;
+    // Kruskal with the distances rounded up to the thresholds: the pairs under each threshold
+    // in turn, on the grid of that threshold, joining the components of the previous cut
+    for (int k = 0; k < work->nCuts; k++){
+        ThresholdCut *cut = &work->cuts[k];
+        linkGrid(res->intersections, n, cut->threshold, keys, (GridCell *)work->cells, work->parent, 1);
+        cut->nClusters = summarizeComponents(res, work->parent, work->order, work->clusterSize, work->bits,
+                                             cut->centroids, &cut->nClusters3);
+    }
+    const ThresholdCut *last = &work->cuts[work->nCuts - 1];
+    memcpy(res->centroids, last->centroids, last->nClusters * sizeof(IntersectionPoint));
+    res->nClusters = last->nClusters;
+    XY_PROBE3(fill_centroids_exit, res->event, n, res->nClusters);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef XYUNION_H
+#define XYUNION_H
+
+#include "xypicmic.h"
+
+// Order independent clustering: clusters are the connected components of the intersections
+// under distance < threshold (single linkage, as in xyincr.h), found by union-find over the
+// neighbor cells of a spatial grid (cells under threshold / sqrt(2), so the points of one
+// cell are joined without a distance check). Unions are lock free (a root is
+// only ever linked below a smaller root, by compare-and-swap) and finds halve the paths, so
+// the threads never wait on each other. The components do not depend on the order of the
+// unions; members are summed and clusters numbered in the order of their strip pairs, so
+// the result is the same bit for bit for any hit order and any number of threads.
+// Unlike the greedy scan of fillCentroids(), every intersection belongs to a cluster.
+
+int reconstructEventUnion(const PixelHit *hits, int nHits, int threshold, EventResult *res, int threads);
+
+// Threshold sweep: the single linkage hierarchy of the event, built once by Kruskal with the
+// distances rounded up to the listed thresholds. In increasing threshold, the pairs under it are
+// united on the union mode grid of that threshold, starting from the components of the previous
+// cut, so pairs already joined are not looked at again. Each cut gives the clusters of
+// reconstructEventUnion() at that threshold, bit for bit.
+typedef struct {
+    int threshold;
+    int nClusters;
+    int nClusters3;                     // 3-color centroids
+    IntersectionPoint *centroids;       // nClusters entries
+    int cap;
+} ThresholdCut;
+
+// The per event buffers grow on demand and are kept between events
+typedef struct {
+    int nCuts;
+    ThresholdCut *cuts;                 // increasing thresholds
+    void *keys;                         // internal: grid and strip order
+    void *cells;
+    int *parent;
+    int *clusterSize;
+    int *order;
+    unsigned char *bits;
+    int keyCap;
+    int pointCap;
+} SweepWork;
+
+SweepWork *createSweepWork(const int *thresholds, int nThresholds);    // thresholds in any order
+void freeSweepWork(SweepWork *work);
+
+// Fills res->lines/split/intersections as reconstructEventUnion() and work->cuts; res->centroids
+// and res->clusterOf are left as the largest cut. Returns 0, -1 on allocation failure.
+int sweepEvent(const PixelHit *hits, int nHits, EventResult *res, SweepWork *work);
+
+#endif /* XYUNION_H */
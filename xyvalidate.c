@@ -0,0 +1,596 @@
+// Differential validation: every reconstruction engine against the frozen reference
+// implementation (xyreference.c), on synthetic events and on recorded event files.
+//   xyvalidate.exe [-n <synthetic events>] [-s <seed>] [-k <max tracks>] [-x <tolerance um>]
+//                  [-e <event file>]... [-v <mismatches to print>]
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "xypicmic.h"
+#include "xyreference.h"
+#include "xybatch.h"
+#include "xycache.h"
+#include "xyparallel.h"
+#include "xysynth.h"
+#include "xyresolve.h"
+#include "xyincr.h"
+#include "xyunion.h"
+#include "xylut.h"
+
+#define MAX_EVENT_FILES 16
+
+typedef struct Engine Engine;
+
+struct Engine {
+    const char *name;
+    int (*run)(const PixelHit *, int, int, EventResult *);
+    bool membership;                    // clusterOf is filled by the engine
+    bool reference;                     // same clusters as the reference, else layout checks only
+    bool linkage;                       // single linkage components, checked against linkageReference()
+    int (*check)(Engine *, const ReferenceResult *, const PixelHit *, int, const char *, long);    // further checks, -1 out of memory
+    unsigned long events;
+    unsigned long countMismatch;        // intersections or clusters
+    unsigned long flagMismatch;         // flag, 3-color bit or cluster number
+    unsigned long centroidMismatch;     // position beyond tolerance
+    unsigned long memberMismatch;
+    double maxDelta;
+    EventResult res;                    // own buffers, grown by this engine only
+};
+
+static int runParallel2(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    return reconstructEventParallel(hits, nHits, threshold, res, 2);
+}
+
+static int runParallel4(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    return reconstructEventParallel(hits, nHits, threshold, res, 4);
+}
+
+// Centroids as they come back out of the result cache
+static ResultCache *validationCache;
+static int runCache(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    if (reconstructEvent(hits, nHits, threshold, res) != 0) return -1;
+    storeResultCache(validationCache, hits, nHits, threshold, res->centroids, res->nClusters, res->interCount);
+    const IntersectionPoint *stored;
+    int n = lookupResultCache(validationCache, hits, nHits, threshold, &stored, NULL);
+    if (n < 0) return -1;
+    memmove(res->centroids, stored, n * sizeof(IntersectionPoint));
+    res->nClusters = n;
+    return 0;
+}
+
+// Strip ownership resolution (-A, and the degraded events of -L): other hits than the
+// clustering, so only its membership layout is checked
+static ResolveWork *validationResolve;
+static int runResolve(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    (void)threshold;
+    return resolveEvent(hits, nHits, RESOLVE_TOLERANCE, res, validationResolve);
+}
+
+// Incremental reconstruction (xyincr.h) as a sliding window: a few hits of the previous event
+// are added first and removed after those of the event, so removeHit() has to split the clusters
+// they bridged (a few only, a larger band threshold would merge most of the event)
+#define WINDOW_HITS 4
+static IncrementalEvent *validationIncremental;
+static PixelHit previousHits[WINDOW_HITS];
+static int nPrevious;
+static int runIncremental(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    (void)threshold;                    // selThreshold() of the hit count, as the trigger uses it
+    IncrementalEvent *ev = validationIncremental;
+    resetIncrementalEvent(ev);
+    for (int i = 0; i < nPrevious; i++) if (addHit(ev, previousHits[i].row, previousHits[i].col) == -2) return -1;
+    for (int i = 0; i < nHits; i++) if (addHit(ev, hits[i].row, hits[i].col) == -2) return -1;
+    for (int i = 0; i < nPrevious; i++) if (removeHit(ev, previousHits[i].row, previousHits[i].col) == -2) return -1;
+    res->interCount = incrementalInterCount(ev);
+    if (reserveEventResult(res, 0, res->interCount + 1) != 0) return -1;
+    res->nClusters = incrementalCentroids(ev, res->centroids, res->interCount + 1);
+    nPrevious = nHits < WINDOW_HITS ? nHits : WINDOW_HITS;
+    memcpy(previousHits, hits, nPrevious * sizeof(PixelHit));
+    return 0;
+}
+
+static int runUnion1(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    return reconstructEventUnion(hits, nHits, threshold, res, 1);
+}
+
+static int runUnion4(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    return reconstructEventUnion(hits, nHits, threshold, res, 4);
+}
+
+// Threshold sweep over the selThreshold() bands: the cut at the event threshold is checked as an
+// engine, and every cut against reconstructEventUnion() at its threshold by checkCuts()
+static const int sweepThresholds[] = {100, 250, 500, 1500};
+static SweepWork *validationSweep;
+static int runSweep(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    if (sweepEvent(hits, nHits, res, validationSweep) != 0) return -1;
+    for (int c = 0; c < validationSweep->nCuts; c++){
+        const ThresholdCut *cut = &validationSweep->cuts[c];
+        if (cut->threshold != threshold) continue;
+        memcpy(res->centroids, cut->centroids, cut->nClusters * sizeof(IntersectionPoint));
+        res->nClusters = cut->nClusters;
+        return 0;
+    }
+    return -1;
+}
+
+// Float crossing tables (xylut.h), see checkLut()
+static IntersectionLUT *validationLUT;
+static int runLut(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    intersectionLUT = validationLUT;
+    int status = reconstructEvent(hits, nHits, threshold, res);
+    intersectionLUT = NULL;
+    return status;
+}
+
+// Resolution under half a strip with the tables, whose acceptance bits drop the Y-R pairs
+// before the B lookup; see checkAccepted()
+#define STRICT_TOLERANCE 0.4
+static int runResolveLut(const PixelHit *hits, int nHits, int threshold, EventResult *res){
+    (void)threshold;
+    intersectionLUT = validationLUT;
+    int status = resolveEvent(hits, nHits, STRICT_TOLERANCE, res, validationResolve);
+    intersectionLUT = NULL;
+    return status;
+}
+
+static int checkCuts(Engine *, const ReferenceResult *, const PixelHit *, int, const char *, long);
+static int checkLut(Engine *, const ReferenceResult *, const PixelHit *, int, const char *, long);
+static int checkAccepted(Engine *, const ReferenceResult *, const PixelHit *, int, const char *, long);
+
+static Engine engines[] = {
+    {"serial", reconstructEvent, true, true, false, NULL, 0, 0, 0, 0, 0, 0},
+    {"grid", reconstructEventGrid, true, true, false, NULL, 0, 0, 0, 0, 0, 0},
+    {"parallel2", runParallel2, true, true, false, NULL, 0, 0, 0, 0, 0, 0},
+    {"parallel4", runParallel4, true, true, false, NULL, 0, 0, 0, 0, 0, 0},
+    {"cache", runCache, false, true, false, NULL, 0, 0, 0, 0, 0, 0},
+    {"resolve", runResolve, true, false, false, NULL, 0, 0, 0, 0, 0, 0},
+    {"incremental", runIncremental, false, false, true, NULL, 0, 0, 0, 0, 0, 0},
+    {"union", runUnion1, true, false, true, NULL, 0, 0, 0, 0, 0, 0},
+    {"union4", runUnion4, true, false, true, NULL, 0, 0, 0, 0, 0, 0},
+    {"sweep", runSweep, false, false, true, checkCuts, 0, 0, 0, 0, 0, 0},
+    {"lut", runLut, true, false, false, checkLut, 0, 0, 0, 0, 0, 0},
+    {"resolve-lut", runResolveLut, true, false, false, checkAccepted, 0, 0, 0, 0, 0, 0},
+};
+#define N_ENGINES ((int)(sizeof(engines) / sizeof(engines[0])))
+
+static int printed, maxPrinted = 10;
+
+static void report(const Engine *e, const char *source, long event, const char *what){
+    if (printed++ < maxPrinted) fprintf(stderr, "%s: %s event %ld: %s\n", e->name, source, event, what);
+}
+
+// buildClusterMembers() of the engine's result against its clusterOf: 0 when consistent,
+// 1 when not, -1 out of memory
+static int checkMembers(EventResult *res){
+    if (buildClusterMembers(res) != 0) return -1;
+    int inClusters = 0;
+    for (int k = 0; k < res->interCount; k++){
+        if (res->clusterOf[k] >= res->nClusters) return 1;
+        inClusters += res->clusterOf[k] >= 0;
+    }
+    if (res->memberStart[0] != 0 || res->memberStart[res->nClusters] != inClusters) return 1;
+    for (int c = 0; c < res->nClusters; c++){
+        if (res->memberStart[c + 1] < res->memberStart[c]) return 1;
+        for (int m = res->memberStart[c]; m < res->memberStart[c + 1]; m++)
+            if (res->clusterOf[res->members[m]] != c) return 1;
+    }
+    return 0;
+}
+
+// Brute force single linkage over the reference intersections: union of every pair closer than
+// the threshold, components numbered in the order of their first intersection
+typedef struct {
+    int nComponents;
+    int *componentOf;                   // per intersection
+    IntersectionPoint *centroids;       // nComponents entries
+    bool *matched;                      // per engine centroid, see compareLinkage()
+    int *mapped;                        // per cluster, see samePartition()
+    int cap;
+} Linkage;
+
+static Linkage linkage;
+
+static int findRoot(int *parent, int i){
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+static int linkageReference(const ReferenceResult *ref, int threshold, Linkage *link){
+    int n = ref->interCount;
+    if (n + 1 > link->cap){
+        int cap = 2 * (n + 1);
+        int *componentOf = (int *)realloc(link->componentOf, cap * sizeof(int));
+        if (componentOf != NULL) link->componentOf = componentOf;
+        IntersectionPoint *centroids = (IntersectionPoint *)realloc(link->centroids, cap * sizeof(IntersectionPoint));
+        if (centroids != NULL) link->centroids = centroids;
+        bool *matched = (bool *)realloc(link->matched, cap * sizeof(bool));
+        if (matched != NULL) link->matched = matched;
+        int *mapped = (int *)realloc(link->mapped, 2 * cap * sizeof(int));
+        if (mapped != NULL) link->mapped = mapped;
+        if (componentOf == NULL || centroids == NULL || matched == NULL || mapped == NULL) return -1;
+        link->cap = cap;
+    }
+    int *parent = link->componentOf;
+    const IntersectionPoint *p = ref->intersections;
+    for (int i = 0; i < n; i++) parent[i] = i;
+    for (int i = 0; i < n; i++){
+        for (int j = i + 1; j < n; j++){
+            if (distance(p[i].x, p[i].y, p[j].x, p[j].y) < threshold){
+                int a = findRoot(parent, i), b = findRoot(parent, j);
+                if (a != b) parent[a > b ? a : b] = a < b ? a : b;
+            }
+        }
+    }
+    // a root is the smallest index of its component, so it is numbered before its members
+    int nComponents = 0;
+    for (int i = 0; i < n; i++) parent[i] = findRoot(parent, i);
+    for (int i = 0; i < n; i++) parent[i] = parent[i] == i ? nComponents++ : parent[parent[i]];
+    link->nComponents = nComponents;
+    int *size = (int *)calloc(nComponents + 1, sizeof(int));
+    if (size == NULL) return -1;
+    for (int c = 0; c < nComponents; c++){
+        IntersectionPoint zero = {0, 0, false, 0, c};
+        link->centroids[c] = zero;
+    }
+    for (int i = 0; i < n; i++){
+        IntersectionPoint *c = &link->centroids[parent[i]];
+        c->x += p[i].x;
+        c->y += p[i].y;
+        c->flag |= p[i].flag == COMBINATION_YR ? 1 : p[i].flag == COMBINATION_YB ? 2 : 4;
+        size[parent[i]]++;
+    }
+    for (int c = 0; c < nComponents; c++){
+        link->centroids[c].x /= size[c];
+        link->centroids[c].y /= size[c];
+        link->centroids[c].intersects = link->centroids[c].flag == 7;
+    }
+    free(size);
+    return 0;
+}
+
+// Whether each of the nOf clusters of "of" (per intersection, -1 none) lies inside one of the nInto
+// clusters of "into", and with exact the other way round too (the same partition)
+static bool samePartition(Linkage *link, const int *of, int nOf, const int *into, int nInto, int n, bool exact){
+    int *intoOf = link->mapped, *ofInto = link->mapped + nOf;
+    for (int c = 0; c < nOf; c++) intoOf[c] = -1;
+    for (int c = 0; c < nInto; c++) ofInto[c] = -1;
+    for (int i = 0; i < n; i++){
+        if (of[i] < 0) continue;
+        if (of[i] >= nOf || into[i] < 0 || into[i] >= nInto) return false;
+        if (intoOf[of[i]] < 0) intoOf[of[i]] = into[i];
+        if (intoOf[of[i]] != into[i]) return false;
+        if (!exact) continue;
+        if (ofInto[into[i]] < 0) ofInto[into[i]] = of[i];
+        if (ofInto[into[i]] != of[i]) return false;
+    }
+    return true;
+}
+
+// Intersection count and the centroids as a set, since single linkage engines number their
+// clusters in another order: each component is paired with the nearest engine centroid left
+static void compareLinkage(Engine *e, Linkage *link, const ReferenceResult *ref, const EventResult *res,
+                           double tolerance, const char *source, long event){
+    if (res->interCount != ref->interCount || res->nClusters != link->nComponents){
+        e->countMismatch++;
+        report(e, source, event, "intersection or component count differs");
+        return;
+    }
+    bool flagBad = false, posBad = false;
+    for (int k = 0; k < res->nClusters; k++) link->matched[k] = false;
+    for (int c = 0; c < link->nComponents; c++){
+        const IntersectionPoint *a = &link->centroids[c];
+        int best = -1;
+        double delta = INFINITY;
+        for (int k = 0; k < res->nClusters; k++){
+            double d = fmax(fabs(a->x - res->centroids[k].x), fabs(a->y - res->centroids[k].y));
+            if (!link->matched[k] && (best < 0 || d < delta)){
+                best = k;
+                delta = d;
+            }
+        }
+        link->matched[best] = true;
+        const IntersectionPoint *b = &res->centroids[best];
+        if (a->flag != b->flag || a->intersects != b->intersects) flagBad = true;
+        if (delta > e->maxDelta) e->maxDelta = delta;
+        if (!(delta <= tolerance)) posBad = true;
+    }
+    if (flagBad){ e->flagMismatch++; report(e, source, event, "component flag differs"); }
+    if (posBad){ e->centroidMismatch++; report(e, source, event, "component centroid beyond tolerance"); }
+    // same intersections as the reference: the clusters are the components, and every greedy
+    // cluster of the reference lies inside one of them
+    if (e->membership && (!samePartition(link, res->clusterOf, res->nClusters, link->componentOf, link->nComponents, ref->interCount, true)
+                          || !samePartition(link, ref->clusterOf, ref->nClusters, res->clusterOf, res->nClusters, ref->interCount, false))){
+        e->memberMismatch++;
+        report(e, source, event, "clusters are not the components, or split a greedy cluster");
+    }
+}
+
+static void compare(Engine *e, const ReferenceResult *ref, const EventResult *res, double tolerance, const char *source, long event){
+    e->events++;
+    if (e->linkage) compareLinkage(e, &linkage, ref, res, tolerance, source, event);
+    if (!e->reference) return;
+    if (res->interCount != ref->interCount || res->nClusters != ref->nClusters){
+        e->countMismatch++;
+        report(e, source, event, "intersection or cluster count differs");
+        return;
+    }
+    bool flagBad = false, posBad = false, memberBad = false;
+    for (int k = 0; k < ref->nClusters; k++){
+        const IntersectionPoint *a = &ref->centroids[k], *b = &res->centroids[k];
+        if (a->flag != b->flag || a->intersects != b->intersects || a->num != b->num) flagBad = true;
+        double delta = fmax(fabs(a->x - b->x), fabs(a->y - b->y));
+        if (delta > e->maxDelta) e->maxDelta = delta;
+        if (!(delta <= tolerance)) posBad = true;
+    }
+    if (e->membership){
+        for (int i = 0; i < ref->interCount; i++) memberBad |= ref->clusterOf[i] != res->clusterOf[i];
+    }
+    if (flagBad){ e->flagMismatch++; report(e, source, event, "centroid flag or number differs"); }
+    if (posBad){ e->centroidMismatch++; report(e, source, event, "centroid position beyond tolerance"); }
+    if (memberBad){ e->memberMismatch++; report(e, source, event, "cluster membership differs"); }
+}
+
+// Every cut of the last sweep against the union mode at its threshold, bit for bit
+static EventResult cutResult;
+static int checkCuts(Engine *e, const ReferenceResult *ref, const PixelHit *hits, int nHits, const char *source, long event){
+    (void)ref;
+    for (int c = 0; c < validationSweep->nCuts; c++){
+        const ThresholdCut *cut = &validationSweep->cuts[c];
+        if (reconstructEventUnion(hits, nHits, cut->threshold, &cutResult, 1) != 0) return -1;
+        int n3 = 0;
+        bool same = cutResult.nClusters == cut->nClusters;
+        for (int k = 0; k < cut->nClusters && same; k++){
+            const IntersectionPoint *a = &cutResult.centroids[k], *b = &cut->centroids[k];
+            same = a->x == b->x && a->y == b->y && a->flag == b->flag && a->intersects == b->intersects && a->num == b->num;
+            n3 += a->intersects;
+        }
+        if (!same || n3 != cut->nClusters3){
+            e->centroidMismatch++;
+            report(e, source, event, "a cut differs from the union mode at its threshold");
+            break;
+        }
+    }
+    return 0;
+}
+
+// The lut engine has to give the greedy clustering of the reference intersections rounded to
+// float, bit for bit. Against the analytic reference its centroids move by less than
+// LUT_TOLERANCE, except where the rounding moved a distance across the threshold: such a tie
+// changes the clusters and is counted apart, as expected.
+#define LUT_TOLERANCE 1e-3
+static unsigned long lutTies;
+static EventResult lutExpected;
+static int checkLut(Engine *e, const ReferenceResult *ref, const PixelHit *hits, int nHits, const char *source, long event){
+    (void)hits;
+    const EventResult *res = &e->res;
+    EventResult *expected = &lutExpected;
+    int n = ref->interCount;
+    if (reserveEventResult(expected, 0, n + 1) != 0) return -1;
+    for (int i = 0; i < n; i++){
+        expected->intersections[i] = ref->intersections[i];
+        expected->intersections[i].x = (float)ref->intersections[i].x;
+        expected->intersections[i].y = (float)ref->intersections[i].y;
+    }
+    expected->nClusters = 0;
+    if (n == 1){
+        expected->centroids[0] = expected->intersections[0];
+        expected->clusterOf[0] = 0;
+        expected->nClusters = 1;
+    }
+    else if (n > 1){
+        init_array(expected->centroids, n);
+        clusterIntersections(selThreshold(nHits), expected->intersections, n, expected->centroids, &expected->nClusters, expected->clusterOf,
+                             expected->clustered, expected->cluster, NULL);
+    }
+
+    if (res->interCount != n || res->nClusters != expected->nClusters){
+        e->countMismatch++;
+        report(e, source, event, "counts differ from the clustering of the rounded intersections");
+        return 0;
+    }
+    bool flagBad = false, posBad = false, memberBad = false;
+    for (int k = 0; k < res->nClusters; k++){
+        const IntersectionPoint *a = &expected->centroids[k], *b = &res->centroids[k];
+        if (a->flag != b->flag || a->intersects != b->intersects || a->num != b->num) flagBad = true;
+        if (a->x != b->x || a->y != b->y) posBad = true;
+    }
+    for (int i = 0; i < n; i++) memberBad |= expected->clusterOf[i] != res->clusterOf[i];
+    if (flagBad){ e->flagMismatch++; report(e, source, event, "flags differ from the clustering of the rounded intersections"); }
+    if (posBad){ e->centroidMismatch++; report(e, source, event, "centroids differ from the clustering of the rounded intersections"); }
+    if (memberBad){ e->memberMismatch++; report(e, source, event, "membership differs from the clustering of the rounded intersections"); }
+
+    bool tie = res->nClusters != ref->nClusters;
+    for (int k = 0; k < res->nClusters && !tie; k++)
+        tie = ref->centroids[k].flag != res->centroids[k].flag || ref->centroids[k].num != res->centroids[k].num;
+    for (int i = 0; i < n && !tie; i++) tie = ref->clusterOf[i] != res->clusterOf[i];
+    if (tie){
+        lutTies++;
+        return 0;
+    }
+    bool drift = false;
+    for (int k = 0; k < res->nClusters; k++){
+        double delta = fmax(fabs(ref->centroids[k].x - res->centroids[k].x), fabs(ref->centroids[k].y - res->centroids[k].y));
+        if (delta > e->maxDelta) e->maxDelta = delta;
+        if (!(delta <= LUT_TOLERANCE)) drift = true;
+    }
+    if (drift && !posBad){
+        e->centroidMismatch++;
+        report(e, source, event, "centroid moved beyond the float rounding");
+    }
+    return 0;
+}
+
+// The acceptance bit of every strip pair of the event has to tell whether stripCoordinates() of
+// the analytic crossing rounds to a read-out strip of the third color, and the resolution with
+// the bits has to give the same hits as without them.
+static EventResult resolveExpected;
+static int checkAccepted(Engine *e, const ReferenceResult *ref, const PixelHit *hits, int nHits, const char *source, long event){
+    (void)ref;
+    static const int pairs[3][3] = {{0, 1, 2}, {0, 2, 1}, {1, 2, 0}};     // colors of LUT_YR, LUT_YB, LUT_RB
+    const EventResult *res = &e->res;
+    const LineCoordinates *lines[3] = {res->split, res->split + res->y_size, res->split + res->y_size + res->r_size};
+    const int size[3] = {res->y_size, res->r_size, res->b_size};
+    bool acceptBad = false;
+    for (int t = 0; t < 3 && !acceptBad; t++){
+        int first = pairs[t][0], second = pairs[t][1], third = pairs[t][2];
+        for (int i = 0; i < size[first] && !acceptBad; i++){
+            for (int j = 0; j < size[second] && !acceptBad; j++){
+                IntersectionPoint p = calculateIntersection(lines[first][i], lines[second][j]);
+                double u[3];
+                stripCoordinates(p.x, p.y, u);
+                long s = lround(u[third]);
+                int expected = s >= 0 && s < STRIP_SLOTS && stripPixel[third][s] >= 0;
+                acceptBad = lutAccepted(validationLUT, t, lines[first][i].val, lines[second][j].val) != expected;
+            }
+        }
+    }
+    if (acceptBad){
+        e->flagMismatch++;
+        report(e, source, event, "acceptance bit differs from stripCoordinates()");
+    }
+
+    EventResult *expected = &resolveExpected;
+    expected->event = res->event;
+    if (resolveEvent(hits, nHits, STRICT_TOLERANCE, expected, validationResolve) != 0) return -1;
+    if (expected->nClusters != res->nClusters){
+        e->countMismatch++;
+        report(e, source, event, "resolution differs without the acceptance bits");
+        return 0;
+    }
+    bool posBad = false;
+    for (int k = 0; k < res->nClusters; k++)
+        posBad |= expected->centroids[k].x != res->centroids[k].x || expected->centroids[k].y != res->centroids[k].y;
+    if (posBad){
+        e->centroidMismatch++;
+        report(e, source, event, "resolved hits differ without the acceptance bits");
+    }
+    return 0;
+}
+
+static int validateEvent(const PixelHit *hits, int nHits, double tolerance, const char *source, long event){
+    ReferenceResult ref;
+    int threshold = selThreshold(nHits);
+    if (referenceReconstruct(hits, nHits, threshold, &ref) != 0) return -1;
+    if (linkageReference(&ref, threshold, &linkage) != 0){
+        freeReferenceResult(&ref);
+        return -1;
+    }
+    for (int k = 0; k < N_ENGINES; k++){
+        EventResult *res = &engines[k].res;
+        if (engines[k].run(hits, nHits, threshold, res) != 0){
+            freeReferenceResult(&ref);
+            return -1;
+        }
+        compare(&engines[k], &ref, res, tolerance, source, event);
+        int layout = engines[k].membership ? checkMembers(res) : 0;
+        if (layout < 0){
+            freeReferenceResult(&ref);
+            return -1;
+        }
+        if (layout > 0){
+            engines[k].memberMismatch++;
+            report(&engines[k], source, event, "membership layout inconsistent");
+        }
+        if (engines[k].check != NULL && engines[k].check(&engines[k], &ref, hits, nHits, source, event) != 0){
+            freeReferenceResult(&ref);
+            return -1;
+        }
+    }
+    freeReferenceResult(&ref);
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    long nSynthetic = 10000;
+    int maxTracks = 8;
+    double tolerance = 1e-9;
+    const char *files[MAX_EVENT_FILES];
+    int nFiles = 0;
+    unsigned long long seed = 0;
+
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) nSynthetic = atol(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) maxTracks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) maxPrinted = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc && nFiles < MAX_EVENT_FILES) files[nFiles++] = argv[++i];
+        else {
+            printf("Usage: %s [-n <synthetic events>] [-s <seed>] [-k <max tracks>] [-x <tolerance um>] [-e <event file>]... [-v <mismatches to print>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (maxTracks < 1) maxTracks = 1;
+    initStripPixelTable();
+    validationCache = createResultCache(64u << 20);
+    validationResolve = createResolveWork();
+    validationIncremental = createIncrementalEvent(0);
+    validationSweep = createSweepWork(sweepThresholds, (int)(sizeof(sweepThresholds) / sizeof(sweepThresholds[0])));
+    initEventResult(&cutResult);
+    initEventResult(&lutExpected);
+    initEventResult(&resolveExpected);
+    validationLUT = buildIntersectionLUT();
+    if (validationLUT == NULL) return 2;
+    for (int k = 0; k < N_ENGINES; k++) initEventResult(&engines[k].res);
+    int status = 0;
+
+    SynthRng rng;
+    seedSynthRng(&rng, seed);
+    PixelHit *hits = (PixelHit *)malloc(SYNTH_MAX_HITS((size_t)maxTracks) * sizeof(PixelHit));
+    for (long ev = 0; ev < nSynthetic && hits != NULL; ev++){
+        int n = syntheticEvent(&rng, hits, maxTracks);
+        if (n > 0 && validateEvent(hits, n, tolerance, "synthetic", ev) != 0){
+            fprintf(stderr, "Out of memory in synthetic event %ld\n", ev);
+            status = 2;
+            break;
+        }
+    }
+    free(hits);
+
+    for (int f = 0; f < nFiles; f++){
+        FILE *in = fopen(files[f], "rb");
+        EventSource src;
+        if (in == NULL || openEventSource(&src, in) != 0){
+            if (in == NULL) perror(files[f]);
+            else fclose(in);
+            status = 2;
+            continue;
+        }
+        PixelHit *eventHits = NULL; int hitCap = 0, nHits = 0, rc;
+        long ev = 0;
+        while ((rc = readEvent(&src, &eventHits, &hitCap, &nHits)) != 0){
+            if (rc < 0) continue;
+            if (validateEvent(eventHits, nHits, tolerance, files[f], ev++) != 0){
+                fprintf(stderr, "Out of memory in %s event %ld\n", files[f], ev - 1);
+                status = 2;
+                break;
+            }
+        }
+        closeEventSource(&src);
+        free(eventHits);
+        fclose(in);
+    }
+
+    printf("engine;events;countMismatch;flagMismatch;centroidMismatch;memberMismatch;maxDelta\n");
+    for (int k = 0; k < N_ENGINES; k++){
+        const Engine *e = &engines[k];
+        printf("%s;%lu;%lu;%lu;%lu;%lu;%.3g\n", e->name, e->events, e->countMismatch, e->flagMismatch,
+               e->centroidMismatch, e->memberMismatch, e->maxDelta);
+        if (e->countMismatch + e->flagMismatch + e->centroidMismatch + e->memberMismatch > 0 && status == 0) status = 1;
+    }
+    if (lutTies > 0) fprintf(stderr, "lut: %lu events clustered differently by a distance tie at float precision (expected)\n", lutTies);
+    for (int k = 0; k < N_ENGINES; k++) freeEventResult(&engines[k].res);
+    freeResultCache(validationCache);
+    freeResolveWork(validationResolve);
+    freeIncrementalEvent(validationIncremental);
+    freeSweepWork(validationSweep);
+    freeEventResult(&cutResult);
+    freeEventResult(&lutExpected);
+    freeEventResult(&resolveExpected);
+    freeIntersectionLUT(validationLUT);
+    free(linkage.componentOf);
+    free(linkage.centroids);
+    free(linkage.matched);
+    free(linkage.mapped);
+    return status;
+}